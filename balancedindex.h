@@ -0,0 +1,410 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#ifndef BALANCEDINDEX_H
+#define BALANCEDINDEX_H
+#include "satnet.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+// SatNet's AVL tree over any key and payload: ground stations by 16-bit ID,
+// debris by 32-bit catalog number, or anything else with a strict weak
+// order. It keeps SatNet's layout and algorithms - nodes in one array of
+// the Allocator's, linked by 32-bit indices, with a free list; iterative
+// insert and remove on a stack of links, retracing only until a subtree
+// keeps its height - but a node is just two links, the key, the payload and
+// a height, sized by each instantiation (16 bytes for a 16-bit key and
+// payload), and Compare is called directly so it inlines. Key and Payload
+// must be default-constructible and copyable.
+//
+// SatNet itself stays the hand-tuned instantiation: its nodes pack the ID
+// and attributes into 12 bytes and carry per-subtree counts, and the
+// attribute bitmaps ride along with every change.
+template <class Key, class Payload, class Compare = std::less<Key>, class Allocator = std::allocator<Key> >
+class BalancedIndex{
+public:
+    friend class Grader;
+    friend class Tester;
+    typedef Key key_type;
+    typedef Payload mapped_type;
+    explicit BalancedIndex(const Compare& compare = Compare(), const Allocator& allocator = Allocator());
+    int size() const {return m_live;}
+    bool empty() const {return m_live == 0;}
+    // levels in the tree, 0 when empty
+    int height() const {return m_nodes[m_root].m_height;}
+    // insert without exceptions, a single descent finds the slot or the duplicate
+    RESULT tryInsert(const Key& key, const Payload& payload);
+    // throws std::runtime_error if the key is already there
+    void insert(const Key& key, const Payload& payload);
+    // SUCCESS, or NOT_FOUND if the key is not there
+    RESULT tryRemove(const Key& key);
+    void remove(const Key& key) {tryRemove(key);}
+    // the payload stored under key, or null; any insert or remove invalidates it
+    const Payload* find(const Key& key) const;
+    Payload* find(const Key& key);
+    bool contains(const Key& key) const {return find(key) != nullptr;}
+    void clear();
+    // replaces the contents with a balanced tree built from the entries in
+    // O(n log n) for the sort and O(n) for the build; the first of repeated keys is kept
+    void bulkLoad(std::vector<std::pair<Key, Payload> > entries);
+    // calls visit(const Key&, const Payload&) for every entry in key order
+    template <class Visit>
+    void forEach(Visit visit) const;
+    // the same for the keys in [low, high], entering only the subtrees that
+    // overlap the range: O(log n + k)
+    template <class Visit>
+    void forEachInRange(const Key& low, const Key& high, Visit visit) const;
+
+private:
+    typedef uint32_t Index;
+    static const Index NONE = 0;        // m_nodes[NONE] is the empty subtree, height 0
+    // an AVL tree of 2^32 nodes is under 47 levels high
+    static const int MAXHEIGHT = 48;
+    // the height goes last, where it usually fills padding
+    struct Node{
+        Index m_left;
+        Index m_right;
+        Key m_key;
+        Payload m_payload;
+        uint8_t m_height;
+    };
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Node> NodeAllocator;
+
+    std::vector<Node, NodeAllocator> m_nodes;
+    Index m_root;
+    Index m_freeList;       // released nodes, linked through m_left
+    int m_live;
+    Compare m_compare;
+
+    bool same(const Key& lhs, const Key& rhs) const {return !m_compare(lhs, rhs) && !m_compare(rhs, lhs);}
+    // room for one more node, so links into m_nodes stay valid during an insert
+    void reserve();
+    Index allocate(const Key& key, const Payload& payload);
+    void release(Index node);
+    void updateHeight(Index node);
+    int getBalance(Index node) const;
+    Index rightRotate(Index node);
+    Index leftRotate(Index node);
+    Index balance(Index node);
+    // rebalances the links in path[0..depth) bottom-up until a subtree keeps its height
+    void retrace(Index* path[], int depth);
+    Index findNode(const Key& key) const;
+    // links entries[lo, hi) into a balanced subtree of fresh nodes
+    Index build(const std::vector<std::pair<Key, Payload> >& entries, size_t lo, size_t hi);
+};
+
+template <class Key, class Payload, class Compare, class Allocator>
+BalancedIndex<Key, Payload, Compare, Allocator>::BalancedIndex(const Compare& compare, const Allocator& allocator)
+        : m_nodes(NodeAllocator(allocator)), m_root(NONE), m_freeList(NONE), m_live(0), m_compare(compare) {
+    m_nodes.resize(1);
+    m_nodes[NONE].m_left = NONE;
+    m_nodes[NONE].m_right = NONE;
+    m_nodes[NONE].m_height = 0;
+}
+
+// NODE POOL
+template <class Key, class Payload, class Compare, class Allocator>
+void BalancedIndex<Key, Payload, Compare, Allocator>::reserve(){
+    if (m_freeList == NONE && m_nodes.size() == m_nodes.capacity()) {
+        m_nodes.reserve(2 * m_nodes.size());
+    }
+}
+
+template <class Key, class Payload, class Compare, class Allocator>
+typename BalancedIndex<Key, Payload, Compare, Allocator>::Index
+BalancedIndex<Key, Payload, Compare, Allocator>::allocate(const Key& key, const Payload& payload){
+    Index node = m_freeList;
+    if (node != NONE) {
+        m_freeList = m_nodes[node].m_left;
+    } else {
+        node = (Index)m_nodes.size();
+        m_nodes.push_back(Node());
+    }
+    Node& slot = m_nodes[node];
+    slot.m_key = key;
+    slot.m_left = NONE;
+    slot.m_right = NONE;
+    slot.m_height = 1;
+    slot.m_payload = payload;
+    m_live++;
+    return node;
+}
+
+template <class Key, class Payload, class Compare, class Allocator>
+void BalancedIndex<Key, Payload, Compare, Allocator>::release(Index node){
+    m_nodes[node].m_left = m_freeList;
+    m_freeList = node;
+    m_live--;
+}
+
+template <class Key, class Payload, class Compare, class Allocator>
+void BalancedIndex<Key, Payload, Compare, Allocator>::clear(){
+    m_nodes.resize(1);
+    m_root = NONE;
+    m_freeList = NONE;
+    m_live = 0;
+}
+
+// ROTATIONS
+template <class Key, class Payload, class Compare, class Allocator>
+void BalancedIndex<Key, Payload, Compare, Allocator>::updateHeight(Index node){
+    uint8_t left = m_nodes[m_nodes[node].m_left].m_height;
+    uint8_t right = m_nodes[m_nodes[node].m_right].m_height;
+    m_nodes[node].m_height = (uint8_t)((left > right ? left : right) + 1);
+}
+
+template <class Key, class Payload, class Compare, class Allocator>
+int BalancedIndex<Key, Payload, Compare, Allocator>::getBalance(Index node) const{
+    return (int)m_nodes[m_nodes[node].m_left].m_height - (int)m_nodes[m_nodes[node].m_right].m_height;
+}
+
+template <class Key, class Payload, class Compare, class Allocator>
+typename BalancedIndex<Key, Payload, Compare, Allocator>::Index
+BalancedIndex<Key, Payload, Compare, Allocator>::rightRotate(Index node){
+    Index newRoot = m_nodes[node].m_left;
+    m_nodes[node].m_left = m_nodes[newRoot].m_right;
+    m_nodes[newRoot].m_right = node;
+    updateHeight(node);
+    updateHeight(newRoot);
+    return newRoot;
+}
+
+template <class Key, class Payload, class Compare, class Allocator>
+typename BalancedIndex<Key, Payload, Compare, Allocator>::Index
+BalancedIndex<Key, Payload, Compare, Allocator>::leftRotate(Index node){
+    Index newRoot = m_nodes[node].m_right;
+    m_nodes[node].m_right = m_nodes[newRoot].m_left;
+    m_nodes[newRoot].m_left = node;
+    updateHeight(node);
+    updateHeight(newRoot);
+    return newRoot;
+}
+
+template <class Key, class Payload, class Compare, class Allocator>
+typename BalancedIndex<Key, Payload, Compare, Allocator>::Index
+BalancedIndex<Key, Payload, Compare, Allocator>::balance(Index node){
+    int balance = getBalance(node);
+    if (balance > 1) {
+        if (getBalance(m_nodes[node].m_left) < 0) {
+            Index left = leftRotate(m_nodes[node].m_left);
+            m_nodes[node].m_left = left;
+        }
+        return rightRotate(node);
+    }
+    if (balance < -1) {
+        if (getBalance(m_nodes[node].m_right) > 0) {
+            Index right = rightRotate(m_nodes[node].m_right);
+            m_nodes[node].m_right = right;
+        }
+        return leftRotate(node);
+    }
+    return node;
+}
+
+template <class Key, class Payload, class Compare, class Allocator>
+void BalancedIndex<Key, Payload, Compare, Allocator>::retrace(Index* path[], int depth){
+    for (int i = depth - 1; i >= 0; i--) {
+        Index node = *path[i];
+        uint8_t oldHeight = m_nodes[node].m_height;
+        updateHeight(node);
+        Index top = balance(node);
+        *path[i] = top;
+        if (m_nodes[top].m_height == oldHeight) {
+            break;
+        }
+    }
+}
+
+// INSERTION
+template <class Key, class Payload, class Compare, class Allocator>
+RESULT BalancedIndex<Key, Payload, Compare, Allocator>::tryInsert(const Key& key, const Payload& payload){
+    // the links on the path point into the node array, which must not move
+    reserve();
+    Index* path[MAXHEIGHT];
+    int depth = 0;
+    Index* link = &m_root;
+    while (*link != NONE) {
+        Node& node = m_nodes[*link];
+        if (m_compare(key, node.m_key)) {
+            path[depth++] = link;
+            link = &node.m_left;
+        } else if (m_compare(node.m_key, key)) {
+            path[depth++] = link;
+            link = &node.m_right;
+        } else {
+            return DUPLICATE;
+        }
+    }
+    *link = allocate(key, payload);
+    retrace(path, depth);
+    return SUCCESS;
+}
+
+template <class Key, class Payload, class Compare, class Allocator>
+void BalancedIndex<Key, Payload, Compare, Allocator>::insert(const Key& key, const Payload& payload){
+    if (tryInsert(key, payload) == DUPLICATE) {
+        throw std::runtime_error("Key already exists");
+    }
+}
+
+// REMOVE
+template <class Key, class Payload, class Compare, class Allocator>
+RESULT BalancedIndex<Key, Payload, Compare, Allocator>::tryRemove(const Key& key){
+    Index* path[MAXHEIGHT];
+    int depth = 0;
+    Index* link = &m_root;
+    for (;;) {
+        if (*link == NONE) {
+            return NOT_FOUND;
+        }
+        Node& node = m_nodes[*link];
+        if (m_compare(key, node.m_key)) {
+            path[depth++] = link;
+            link = &node.m_left;
+        } else if (m_compare(node.m_key, key)) {
+            path[depth++] = link;
+            link = &node.m_right;
+        } else {
+            break;
+        }
+    }
+
+    Index node = *link;
+    if (m_nodes[node].m_left != NONE && m_nodes[node].m_right != NONE) {
+        // the inorder successor's entry moves up and its node is unlinked instead
+        path[depth++] = link;
+        link = &m_nodes[node].m_right;
+        while (m_nodes[*link].m_left != NONE) {
+            path[depth++] = link;
+            link = &m_nodes[*link].m_left;
+        }
+        Index successor = *link;
+        m_nodes[node].m_key = m_nodes[successor].m_key;
+        m_nodes[node].m_payload = m_nodes[successor].m_payload;
+        *link = m_nodes[successor].m_right;
+        release(successor);
+    } else {
+        *link = (m_nodes[node].m_left == NONE) ? m_nodes[node].m_right : m_nodes[node].m_left;
+        release(node);
+    }
+    retrace(path, depth);
+    return SUCCESS;
+}
+
+// FIND
+template <class Key, class Payload, class Compare, class Allocator>
+typename BalancedIndex<Key, Payload, Compare, Allocator>::Index
+BalancedIndex<Key, Payload, Compare, Allocator>::findNode(const Key& key) const{
+    Index node = m_root;
+    while (node != NONE) {
+        const Node& n = m_nodes[node];
+        if (m_compare(key, n.m_key)) {
+            node = n.m_left;
+        } else if (m_compare(n.m_key, key)) {
+            node = n.m_right;
+        } else {
+            return node;
+        }
+    }
+    return NONE;
+}
+
+template <class Key, class Payload, class Compare, class Allocator>
+const Payload* BalancedIndex<Key, Payload, Compare, Allocator>::find(const Key& key) const{
+    Index node = findNode(key);
+    return node == NONE ? nullptr : &m_nodes[node].m_payload;
+}
+
+template <class Key, class Payload, class Compare, class Allocator>
+Payload* BalancedIndex<Key, Payload, Compare, Allocator>::find(const Key& key){
+    Index node = findNode(key);
+    return node == NONE ? nullptr : &m_nodes[node].m_payload;
+}
+
+// BULK LOADING
+template <class Key, class Payload, class Compare, class Allocator>
+void BalancedIndex<Key, Payload, Compare, Allocator>::bulkLoad(std::vector<std::pair<Key, Payload> > entries){
+    const Compare& compare = m_compare;
+    std::stable_sort(entries.begin(), entries.end(),
+                     [&compare](const std::pair<Key, Payload>& lhs, const std::pair<Key, Payload>& rhs) {
+                         return compare(lhs.first, rhs.first);
+                     });
+    size_t kept = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (kept == 0 || !same(entries[kept - 1].first, entries[i].first)) {
+            entries[kept++] = entries[i];
+        }
+    }
+    entries.resize(kept);
+    clear();
+    m_nodes.reserve(kept + 1);
+    m_root = build(entries, 0, kept);
+}
+
+// the middle entry becomes the root, so the heights come out right without a rotation
+template <class Key, class Payload, class Compare, class Allocator>
+typename BalancedIndex<Key, Payload, Compare, Allocator>::Index
+BalancedIndex<Key, Payload, Compare, Allocator>::build(const std::vector<std::pair<Key, Payload> >& entries,
+                                                       size_t lo, size_t hi){
+    if (lo == hi) {
+        return NONE;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    Index node = allocate(entries[mid].first, entries[mid].second);
+    Index left = build(entries, lo, mid);
+    Index right = build(entries, mid + 1, hi);
+    m_nodes[node].m_left = left;
+    m_nodes[node].m_right = right;
+    updateHeight(node);
+    return node;
+}
+
+// ITERATION
+template <class Key, class Payload, class Compare, class Allocator>
+template <class Visit>
+void BalancedIndex<Key, Payload, Compare, Allocator>::forEach(Visit visit) const{
+    Index stack[MAXHEIGHT];
+    int depth = 0;
+    Index node = m_root;
+    while (node != NONE || depth > 0) {
+        while (node != NONE) {
+            stack[depth++] = node;
+            node = m_nodes[node].m_left;
+        }
+        node = stack[--depth];
+        visit(m_nodes[node].m_key, m_nodes[node].m_payload);
+        node = m_nodes[node].m_right;
+    }
+}
+
+template <class Key, class Payload, class Compare, class Allocator>
+template <class Visit>
+void BalancedIndex<Key, Payload, Compare, Allocator>::forEachInRange(const Key& low, const Key& high, Visit visit) const{
+    Index stack[MAXHEIGHT];
+    int depth = 0;
+    Index node = m_root;
+    while (node != NONE || depth > 0) {
+        // go left only while the left subtree can still hold keys >= low
+        while (node != NONE) {
+            if (m_compare(m_nodes[node].m_key, low)) {
+                node = m_nodes[node].m_right;
+            } else {
+                stack[depth++] = node;
+                node = m_nodes[node].m_left;
+            }
+        }
+        if (depth == 0) {
+            break;
+        }
+        node = stack[--depth];
+        if (m_compare(high, m_nodes[node].m_key)) {
+            return;
+        }
+        visit(m_nodes[node].m_key, m_nodes[node].m_payload);
+        node = m_nodes[node].m_right;
+    }
+}
+#endif
@@ -0,0 +1,211 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#include "concurrentsatnet.h"
+#include <algorithm>
+
+ConcurrentSatNet::ConcurrentSatNet()
+        : m_states(MAXID - MINID + 1), m_stateDeltas((MAXID - MINID + 2) * NUMSTATES) {
+    for (int i = 0; i < NUMSTATES; i++) {
+        m_stateTotals[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+// STRUCTURAL WRITERS
+// The tree and the side array change under the same exclusive lock, so a
+// satellite turns up in both or in neither for any locked reader.
+
+void ConcurrentSatNet::publish(const Sat& satellite){
+    m_states[satellite.getID() - MINID].store((uint8_t)(satellite.getState() + 1), std::memory_order_release);
+    m_stateTotals[satellite.getState()].fetch_add(1, std::memory_order_relaxed);
+}
+
+// the exchange takes the state from under any setState still in flight, so
+// the satellite leaves the totals from the state it really had. The tree
+// drops it from the stale state's counts, so the correction moves back from
+// the real state to the stale one; a setState whose own correction has not
+// landed yet only adds the step that gets the sum for this ID back to zero.
+void ConcurrentSatNet::retire(int id, STATE stale){
+    uint8_t old = m_states[id - MINID].exchange(NOSTATE, std::memory_order_acq_rel);
+    if (old != NOSTATE) {
+        m_stateTotals[old - 1].fetch_sub(1, std::memory_order_relaxed);
+        moveDelta(id, old - 1, stale);
+    }
+}
+
+void ConcurrentSatNet::moveDelta(int id, int from, int to){
+    if (from == to) {
+        return;
+    }
+    int size = MAXID - MINID + 1;
+    for (int i = id - MINID + 1; i <= size; i += i & -i) {
+        m_stateDeltas[i * NUMSTATES + from].fetch_sub(1, std::memory_order_relaxed);
+        m_stateDeltas[i * NUMSTATES + to].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ConcurrentSatNet::deltasUpTo(int id, int deltas[NUMSTATES]) const{
+    for (int k = 0; k < NUMSTATES; k++) {
+        deltas[k] = 0;
+    }
+    for (int i = std::min(id, MAXID) - MINID + 1; i > 0; i -= i & -i) {
+        for (int k = 0; k < NUMSTATES; k++) {
+            deltas[k] += m_stateDeltas[i * NUMSTATES + k].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void ConcurrentSatNet::insert(const Sat& satellite){
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_satNet.insert(satellite);
+    publish(satellite);
+}
+
+RESULT ConcurrentSatNet::tryInsert(const Sat& satellite){
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    RESULT result = m_satNet.tryInsert(satellite);
+    if (result == SUCCESS) {
+        publish(satellite);
+    }
+    return result;
+}
+
+void ConcurrentSatNet::clear(){
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    std::vector<SatIndex> nodes;
+    m_satNet.flattenNodes(nodes);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const SatNode& node = m_satNet.m_pool[nodes[i]];
+        retire(node.m_id, node.getState());
+    }
+    m_satNet.clear();
+}
+
+void ConcurrentSatNet::remove(int id){
+    tryRemove(id);
+}
+
+RESULT ConcurrentSatNet::tryRemove(int id){
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    SatIndex node = m_satNet.findNode(id);
+    STATE stale = (node == NOSAT) ? ACTIVE : m_satNet.m_pool[node].getState();
+    RESULT result = m_satNet.tryRemove(id);
+    if (result == SUCCESS) {
+        retire(id, stale);
+    }
+    return result;
+}
+
+// The tree's own states are stale, so the side array decides. A satellite
+// is only removed if its slot can be cleared while it still says DEORBITED,
+// so a concurrent setState either lands first and saves it, or fails.
+int ConcurrentSatNet::removeDeorbited(){
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    return m_satNet.removeIf([this](const Sat& satellite) {
+        std::atomic<uint8_t>& slot = m_states[satellite.getID() - MINID];
+        uint8_t deorbited = DEORBITED + 1;
+        if (!slot.compare_exchange_strong(deorbited, NOSTATE, std::memory_order_acq_rel)) {
+            return false;
+        }
+        m_stateTotals[DEORBITED].fetch_sub(1, std::memory_order_relaxed);
+        moveDelta(satellite.getID(), DEORBITED, satellite.getState());
+        return true;
+    });
+}
+
+// STATE UPDATES
+// A compare-and-swap against the state just read, so a setState racing a
+// removal or another setState never moves a satellite between totals it
+// was not in.
+bool ConcurrentSatNet::setState(int id, STATE state){
+    if (id < MINID || id > MAXID) {
+        return false;
+    }
+    std::atomic<uint8_t>& slot = m_states[id - MINID];
+    uint8_t old = slot.load(std::memory_order_acquire);
+    do {
+        if (old == NOSTATE) {
+            return false;
+        }
+        if (old == state + 1) {
+            return true;
+        }
+    } while (!slot.compare_exchange_weak(old, (uint8_t)(state + 1), std::memory_order_acq_rel));
+
+    m_stateTotals[old - 1].fetch_sub(1, std::memory_order_relaxed);
+    m_stateTotals[state].fetch_add(1, std::memory_order_relaxed);
+    moveDelta(id, old - 1, state);
+    return true;
+}
+
+bool ConcurrentSatNet::getState(int id, STATE& state) const {
+    if (id < MINID || id > MAXID) {
+        return false;
+    }
+    uint8_t slot = m_states[id - MINID].load(std::memory_order_acquire);
+    if (slot == NOSTATE) {
+        return false;
+    }
+    state = (STATE)(slot - 1);
+    return true;
+}
+
+// LOCKED READS
+
+bool ConcurrentSatNet::findSatellite(int id) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_satNet.findNode(id) != NOSAT;
+}
+
+int ConcurrentSatNet::countSatellites(INCLIN degree) const{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_satNet.countSatellites(degree);
+}
+
+int ConcurrentSatNet::countSatellites(ALT altitude) const{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_satNet.countSatellites(altitude);
+}
+
+int ConcurrentSatNet::countSatellites(STATE state) const{
+    return m_stateTotals[state].load(std::memory_order_relaxed);
+}
+
+// everything comes from the tree's per-subtree counts; the stale state
+// counts are corrected by the deltas up to maxID minus those below minID
+SatCounts ConcurrentSatNet::getCounts(int minID, int maxID) const{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    SatCounts counts = m_satNet.getCounts(minID, maxID);
+    if (minID > maxID) {
+        return counts;
+    }
+    int upper[NUMSTATES];
+    int below[NUMSTATES];
+    deltasUpTo(maxID, upper);
+    deltasUpTo(minID - 1, below);
+    for (int k = 0; k < NUMSTATES; k++) {
+        counts.m_state[k] += upper[k] - below[k];
+    }
+    return counts;
+}
+
+void ConcurrentSatNet::applyStates(SatNet& satNet) const{
+    std::vector<SatIndex> nodes;
+    satNet.flattenNodes(nodes);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        int id = satNet.m_pool[nodes[i]].m_id;
+        uint8_t slot = m_states[id - MINID].load(std::memory_order_relaxed);
+        if (slot != NOSTATE && satNet.m_pool[nodes[i]].getState() != (STATE)(slot - 1)) {
+            satNet.setState(id, (STATE)(slot - 1));
+        }
+    }
+}
+
+SatNet ConcurrentSatNet::copy() const{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    SatNet satNet = m_satNet;
+    applyStates(satNet);
+    return satNet;
+}
+
+SatSnapshot ConcurrentSatNet::freezeSnapshot() const{
+    return copy().freezeSnapshot();
+}
@@ -0,0 +1,78 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#ifndef CONCURRENTSATNET_H
+#define CONCURRENTSATNET_H
+#include "satnet.h"
+#include "satsnapshot.h"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+// A SatNet that many threads can use at once. Structural writers (insert,
+// remove, removeDeorbited, clear) take the lock exclusively and run one at a
+// time. Lookups take the lock shared, so any number of readers run together
+// but wait for a writer, and a writer waits for them. No read of the tree
+// happens outside the lock: the nodes are plain memory, and a reader racing
+// a rotation would be a data race however its result was checked afterwards.
+//
+// States live outside the tree, in one atomic byte per possible ID, so
+// setState and getState never lock and never wait for a structural writer.
+// The states stored in the tree's nodes go stale, and copies of the tree get
+// their states from the side array. The fleet-wide state counts are kept in
+// atomic totals. Range counts come from the tree's per-subtree counts under
+// the shared lock, corrected by a Fenwick tree over the ID range that holds,
+// per state, how far the side array has moved from the nodes' states; each
+// setState adds to it in O(log range) without a lock.
+class ConcurrentSatNet{
+public:
+    friend class Grader;
+    friend class Tester;
+    ConcurrentSatNet();
+    ConcurrentSatNet(const ConcurrentSatNet& rhs) = delete;
+    ConcurrentSatNet& operator=(const ConcurrentSatNet& rhs) = delete;
+    void insert(const Sat& satellite);
+    RESULT tryInsert(const Sat& satellite);
+    void clear();
+    void remove(int id);
+    RESULT tryRemove(int id);
+    // lock-free; false if the satellite is not in the fleet
+    bool setState(int id, STATE state);
+    int removeDeorbited();
+    bool findSatellite(int id) const;
+    // lock-free; false if the satellite is not in the fleet
+    bool getState(int id, STATE& state) const;
+    int countSatellites(INCLIN degree) const;
+    int countSatellites(ALT altitude) const;
+    // lock-free; exact whenever no setState is halfway through
+    int countSatellites(STATE state) const;
+    // all totals for IDs in [minID, maxID], in O(log n); the state counts
+    // are exact whenever no setState is halfway through
+    SatCounts getCounts(int minID = MINID, int maxID = MAXID) const;
+    // copies of the fleet, taken under the shared lock; each state is one the
+    // satellite had while the copy was made
+    SatNet copy() const;
+    SatSnapshot freezeSnapshot() const;
+
+private:
+    // side array slot of a satellite not in the fleet; otherwise a slot holds state + 1
+    static const uint8_t NOSTATE = 0;
+
+    SatNet m_satNet;
+    mutable std::shared_mutex m_mutex;
+    std::vector<std::atomic<uint8_t> > m_states;   // indexed by id - MINID
+    std::atomic<int> m_stateTotals[NUMSTATES];      // satellites in each state
+    // Fenwick tree, NUMSTATES entries per position 1 .. MAXID - MINID + 1, of
+    // the side array's states minus the tree's, so the correction for IDs up
+    // to id is a prefix sum
+    std::vector<std::atomic<int> > m_stateDeltas;
+
+    // side array bookkeeping for structural writers, called under the
+    // exclusive lock; retire is told the state the tree's node still holds
+    void publish(const Sat& satellite);
+    void retire(int id, STATE stale);
+    // moves one satellite's correction from one state to another
+    void moveDelta(int id, int from, int to);
+    // the correction to each state's count for IDs in [MINID, id]
+    void deltasUpTo(int id, int deltas[NUMSTATES]) const;
+    // replaces the states in a copy of the tree with the ones in the side array
+    void applyStates(SatNet& satNet) const;
+};
+#endif
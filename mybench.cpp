@@ -0,0 +1,1392 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+// Throughput benchmarks for SatNet, built separately from the test suite:
+//     g++ -std=c++17 -O2 -pthread -o bench satnet.cpp sattable.cpp satsnapshot.cpp concurrentsatnet.cpp persistentsatnet.cpp satworkers.cpp satquery.cpp satwriter.cpp satimage.cpp satjournal.cpp satingest.cpp mybench.cpp
+//     ./bench [--latency] [--json results.json]
+// --latency runs only the latency suite (BENCH 20); --json also writes every
+// row to a JSON file for tracking results over time.
+#include "satnet.h"
+#include "sattable.h"
+#include "satsnapshot.h"
+#include "concurrentsatnet.h"
+#include "persistentsatnet.h"
+#include "satworkers.h"
+#include "satquery.h"
+#include "satwriter.h"
+#include "satimage.h"
+#include "satjournal.h"
+#include "satingest.h"
+#include "balancedindex.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+enum WORKLOAD {SEQUENTIAL, RANDOMIDS, CLUSTERED};
+const char* const WORKLOADNAMES[] = {"sequential", "random", "clustered"};
+
+class Bench{
+public:
+    // BENCH 1: node pool versus one heap allocation per node
+    void benchPoolVsHeap(int n);
+    // BENCH 2: the same operations against a storage backend (SatNet or SatTable)
+    template <class Fleet>
+    void benchBackend(const std::string& name, int n);
+    // BENCH 3: bulkLoad versus inserting the same batch one at a time
+    void benchBulkLoad(int n);
+    // BENCH 4: rejecting duplicates through tryInsert versus insert and catch
+    void benchDuplicates(int n);
+    // BENCH 5: steady-state churn, one removal and one insert per step on a tree of n
+    void benchChurn(int n);
+    // BENCH 6: removeDeorbited sweep after a decommission campaign
+    void benchRemoveDeorbited(int n);
+    // BENCH 7: random lookups, AVL tree versus frozen Eytzinger snapshot
+    void benchSnapshot(int n);
+    // BENCH 8: batched findSatellites and setStates versus one call per ID
+    void benchBatchedLookup(int n);
+    // BENCH 9: ConcurrentSatNet lookups from several reader threads while one writer churns
+    void benchConcurrentReads(int readers);
+    // BENCH 10: setState from several threads, SatNet behind one mutex versus lock-free ConcurrentSatNet
+    void benchConcurrentStates(int threads);
+    // BENCH 11: keeping 100 versions of a changing fleet, deep copies versus PersistentSatNet snapshots
+    void benchVersions(int n);
+    // BENCH 12: bulkLoad and copyFrom of a full fleet split across SatWorkers threads
+    void benchParallelBuild(int threads);
+    // BENCH 13: fleet-wide histogram and filtered ID list split across SatWorkers threads
+    void benchParallelQuery(int threads);
+    // BENCH 14: IDs with two given attributes, attribute index versus a walk of the tree
+    void benchAttributeIndex(int n);
+    // BENCH 15: a report on one block of 1,000 IDs, whole-tree walk versus range iteration
+    void benchBlockReport(int n);
+    // BENCH 16: listing the fleet, a flushed line per satellite versus one SatWriter buffer
+    void benchListing(int n);
+    // BENCH 17: restarting with a fleet, inserts one by one versus a binary snapshot file
+    void benchRestart(int n);
+    // BENCH 18: setState with a journal, by group size, and replaying the journal
+    void benchJournal(int groupSize);
+    // BENCH 19: loading a catalog of the given number of lines, getline and
+    // stringstream with one insert per line versus SatIngest
+    void benchIngest(int lines);
+    // BENCH 20: latency percentiles and rate of each operation, by ID workload and size
+    void benchLatency(WORKLOAD workload, int n);
+    // the cost of reading the clock, which every BENCH 20 sample includes once
+    void benchClock();
+    // BENCH 21: SatNet versus BalancedIndex instantiations on the same IDs
+    void benchBalancedIndex(int n);
+    // every row reported so far, as JSON; false, after saying why on stderr,
+    // if the file could not be written
+    bool writeJSON(const std::string& path) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    static const int TRIALS = 7;        // measured trials per BENCH 20 row, after one warmup
+    // one reported row; the latency fields are negative for throughput rows
+    struct Result{
+        std::string m_name;
+        std::string m_workload;
+        int m_n;
+        double m_ms;
+        double m_opsPerSec;
+        double m_p50Ns;
+        double m_p99Ns;
+        double m_kb;
+    };
+    std::vector<Result> m_results;
+
+    // shuffled unique IDs in [MINID, MINID + n)
+    static std::vector<int> shuffledIDs(int n);
+    // milliseconds since start
+    static double elapsedMs(std::chrono::steady_clock::time_point start);
+    void report(const std::string& name, int n, double ms);
+    // prints the memory a row's n items hold, in KB, instead of a rate
+    void reportMemory(const std::string& name, int n, size_t bytes);
+    // tryInserts every ID - offset as a Key, then looks each one up; returns ms
+    template <class Index, class Key>
+    static double timeIndex(Index& index, const std::vector<int>& ids, int offset, int& found);
+    // n IDs in the workload's order
+    static std::vector<int> workloadIDs(WORKLOAD workload, int n);
+    // calls operation(i) for i in [0, count) and reads the clock after each,
+    // appending one latency in ns per call; returns the total in ns
+    template <class Operation>
+    static double timeEach(int count, std::vector<double>& samples, Operation operation);
+    // runs trial(samples) once to warm up, then trials times, and reports
+    // the percentiles of every measured sample and the median trial's rate
+    template <class Trial>
+    void measure(const std::string& name, WORKLOAD workload, int n, Trial trial, int trials = TRIALS);
+};
+
+int main(int argc, char** argv){
+    bool latencyOnly = false;
+    std::string jsonPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--latency") {
+            latencyOnly = true;
+        } else if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--latency] [--json results.json]" << std::endl;
+            return 1;
+        }
+    }
+
+    Bench bench;
+    int sizes[] = {1000, 10000, 90000};
+    if (!latencyOnly) {
+        std::cout << std::left << std::setw(32) << "benchmark" << std::setw(10) << "n"
+                  << std::setw(12) << "ms" << "Mops/s" << std::endl;
+        for (int n : sizes) {
+            bench.benchPoolVsHeap(n);
+        }
+        for (int n : sizes) {
+            bench.benchBackend<SatNet>("SatNet", n);
+            bench.benchBackend<SatTable>("SatTable", n);
+        }
+        for (int n : sizes) {
+            bench.benchBulkLoad(n);
+        }
+        for (int n : sizes) {
+            bench.benchDuplicates(n);
+        }
+        for (int n : sizes) {
+            bench.benchChurn(n);
+        }
+        for (int n : sizes) {
+            bench.benchRemoveDeorbited(n);
+        }
+        for (int n : sizes) {
+            bench.benchSnapshot(n);
+        }
+        for (int n : sizes) {
+            bench.benchBatchedLookup(n);
+        }
+        int readers[] = {1, 2, 4, 8};
+        for (int r : readers) {
+            bench.benchConcurrentReads(r);
+        }
+        for (int t : readers) {
+            bench.benchConcurrentStates(t);
+        }
+        for (int n : sizes) {
+            bench.benchVersions(n);
+        }
+        int threads[] = {1, 2, 4, 8, 16};
+        for (int t : threads) {
+            bench.benchParallelBuild(t);
+        }
+        for (int t : threads) {
+            bench.benchParallelQuery(t);
+        }
+        for (int n : sizes) {
+            bench.benchAttributeIndex(n);
+        }
+        for (int n : sizes) {
+            bench.benchBlockReport(n);
+        }
+        for (int n : sizes) {
+            bench.benchListing(n);
+        }
+        for (int n : sizes) {
+            bench.benchRestart(n);
+        }
+        int groups[] = {1, 16, 256, 4096};
+        for (int g : groups) {
+            bench.benchJournal(g);
+        }
+        for (int n : sizes) {
+            bench.benchBalancedIndex(n);
+        }
+        int catalogs[] = {100000, 1000000, 10000000};
+        for (int lines : catalogs) {
+            bench.benchIngest(lines);
+        }
+    }
+
+    std::cout << std::endl << std::left << std::setw(32) << "latency" << std::setw(10) << "n"
+              << std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns" << "ops/s" << std::endl;
+    bench.benchClock();
+    WORKLOAD workloads[] = {SEQUENTIAL, RANDOMIDS, CLUSTERED};
+    for (WORKLOAD workload : workloads) {
+        for (int n : sizes) {
+            bench.benchLatency(workload, n);
+        }
+    }
+    if (!jsonPath.empty() && !bench.writeJSON(jsonPath)) {
+        return 1;
+    }
+    return 0;
+}
+
+std::vector<int> Bench::shuffledIDs(int n) {
+    std::vector<int> ids;
+    for (int i = 0; i < n; i++) {
+        ids.push_back(MINID + i);
+    }
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(10));
+    return ids;
+}
+
+double Bench::elapsedMs(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+void Bench::report(const std::string& name, int n, double ms) {
+    m_results.push_back(Result{name, "", n, ms, ms > 0 ? n / ms * 1000.0 : 0.0, -1, -1, -1});
+    std::cout << std::left << std::setw(32) << name << std::setw(10) << n
+              << std::setw(12) << std::fixed << std::setprecision(3) << ms
+              << (ms > 0 ? n / ms / 1000.0 : 0.0) << std::endl;
+}
+
+void Bench::reportMemory(const std::string& name, int n, size_t bytes) {
+    m_results.push_back(Result{name, "", n, -1, -1, -1, -1, bytes / 1024.0});
+    std::cout << std::left << std::setw(32) << name << std::setw(10) << n
+              << std::setw(12) << std::fixed << std::setprecision(1) << bytes / 1024.0 << "KB" << std::endl;
+}
+
+// BENCH 1: node pool versus one heap allocation per node
+// The heap rows reproduce the old layout: a new 40-byte node (the satellite,
+// two child pointers and a height) per insert and a delete per node on clear,
+// in insertion order so the frees are as scattered as the tree.
+void Bench::benchPoolVsHeap(int n) {
+    struct HeapNode{
+        Sat m_satellite;
+        HeapNode* m_left;
+        HeapNode* m_right;
+        int m_height;
+    };
+    std::vector<int> ids = shuffledIDs(n);
+    std::vector<HeapNode*> nodes(n);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        nodes[i] = new HeapNode{Sat(ids[i]), nullptr, nullptr, 1};
+    }
+    report("heap alloc", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        delete nodes[i];
+    }
+    report("heap free", n, elapsedMs(start));
+
+    SatPool pool;
+    std::vector<SatIndex> slots(n);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        slots[i] = pool.allocate(Sat(ids[i]));
+    }
+    report("pool alloc", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    pool.reset();
+    report("pool reset", n, elapsedMs(start));
+
+    SatNet satNet;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        satNet.insert(Sat(ids[i]));
+    }
+    report("SatNet insert", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    satNet.clear();
+    report("SatNet clear", n, elapsedMs(start));
+
+    // a second build reuses the array capacity SatPool::reset keeps through clear()
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        satNet.insert(Sat(ids[i]));
+    }
+    report("SatNet insert (warm pool)", n, elapsedMs(start));
+
+    SatNet copy;
+    start = std::chrono::steady_clock::now();
+    copy = satNet;
+    report("SatNet operator=", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    SatNet constructed(satNet);
+    report("SatNet copy constructor", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    SatNet moved(std::move(constructed));
+    copy = std::move(moved);
+    report("SatNet move construct+assign", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    satNet.swap(copy);
+    report("SatNet swap", n, elapsedMs(start));
+}
+
+// BENCH 2: the same operations against a storage backend (SatNet or SatTable)
+template <class Fleet>
+void Bench::benchBackend(const std::string& name, int n) {
+    std::vector<int> ids = shuffledIDs(n);
+    Fleet fleet;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        fleet.insert(Sat(ids[i], (ALT)(i % NUMALTS), (INCLIN)(i % NUMINCLINS)));
+    }
+    report(name + " insert", n, elapsedMs(start));
+
+    int found = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        found += fleet.findSatellite(ids[i]);
+    }
+    report(name + " findSatellite", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        fleet.setState(ids[i], DECAYING);
+    }
+    report(name + " setState", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        found += fleet.countSatellites(I53, ids[i], ids[i] + 5000);
+    }
+    report(name + " countSatellites(range)", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        fleet.remove(ids[i]);
+    }
+    report(name + " remove", n, elapsedMs(start));
+
+    // keeps the lookups from being optimized away
+    if (found < 0) {
+        std::cout << found << std::endl;
+    }
+}
+
+// BENCH 3: bulkLoad versus inserting the same batch one at a time
+void Bench::benchBulkLoad(int n) {
+    std::vector<int> ids = shuffledIDs(n);
+    std::vector<Sat> batch;
+    for (int i = 0; i < n; i++) {
+        batch.push_back(Sat(ids[i]));
+    }
+
+    SatNet satNet;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        satNet.insert(batch[i]);
+    }
+    report("insert one by one", n, elapsedMs(start));
+
+    SatNet loaded;
+    start = std::chrono::steady_clock::now();
+    loaded.bulkLoad(batch);
+    report("bulkLoad", n, elapsedMs(start));
+
+    // half the fleet is already there, the other half is new
+    std::vector<Sat> more;
+    for (int i = 0; i < n; i++) {
+        more.push_back(Sat(MINID + n / 2 + i));
+    }
+    start = std::chrono::steady_clock::now();
+    loaded.bulkMerge(more);
+    report("bulkMerge", n, elapsedMs(start));
+}
+
+// BENCH 4: rejecting duplicates through tryInsert versus insert and catch
+void Bench::benchDuplicates(int n) {
+    std::vector<int> ids = shuffledIDs(n);
+    SatNet satNet;
+    for (int i = 0; i < n; i++) {
+        satNet.insert(Sat(ids[i]));
+    }
+
+    int rejected = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        try {
+            satNet.insert(Sat(ids[i]));
+        }
+        catch (const std::exception& e) {
+            rejected++;
+        }
+    }
+    report("duplicate insert (throw)", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        rejected += (satNet.tryInsert(Sat(ids[i])) == DUPLICATE);
+    }
+    report("duplicate tryInsert", n, elapsedMs(start));
+
+    if (rejected != 2 * n) {
+        std::cout << "unexpected: " << rejected << " rejected" << std::endl;
+    }
+}
+
+// BENCH 5's baseline: an AVL tree of bare IDs that retraces like
+// SatNet::retrace, stopping at the first level whose height did not change,
+// or with fullPath walks every level back to the root as the recursive
+// insert and remove did. levels() counts the levels retraced either way.
+class ChurnTree{
+public:
+    ChurnTree(int capacity, bool fullPath) : m_root(NONE), m_fullPath(fullPath), m_levels(0) {
+        // the path holds pointers into m_nodes, which must not move
+        m_nodes.reserve(capacity + 1);
+        m_nodes.push_back(Node{0, NONE, NONE, 0});
+    }
+    void insert(int id) {
+        uint32_t* path[MAXHEIGHT];
+        int depth = 0;
+        uint32_t* link = &m_root;
+        while (*link != NONE) {
+            path[depth++] = link;
+            Node& node = m_nodes[*link];
+            link = (id < node.m_id) ? &node.m_left : &node.m_right;
+        }
+        if (m_free.empty()) {
+            *link = (uint32_t)m_nodes.size();
+            m_nodes.push_back(Node{id, NONE, NONE, 1});
+        } else {
+            *link = m_free.back();
+            m_free.pop_back();
+            m_nodes[*link] = Node{id, NONE, NONE, 1};
+        }
+        retrace(path, depth);
+    }
+    void remove(int id) {
+        uint32_t* path[MAXHEIGHT];
+        int depth = 0;
+        uint32_t* link = &m_root;
+        while (*link != NONE && m_nodes[*link].m_id != id) {
+            path[depth++] = link;
+            Node& node = m_nodes[*link];
+            link = (id < node.m_id) ? &node.m_left : &node.m_right;
+        }
+        if (*link == NONE) {
+            return;
+        }
+        uint32_t node = *link;
+        if (m_nodes[node].m_left != NONE && m_nodes[node].m_right != NONE) {
+            path[depth++] = link;
+            link = &m_nodes[node].m_right;
+            while (m_nodes[*link].m_left != NONE) {
+                path[depth++] = link;
+                link = &m_nodes[*link].m_left;
+            }
+            uint32_t successor = *link;
+            m_nodes[node].m_id = m_nodes[successor].m_id;
+            *link = m_nodes[successor].m_right;
+            m_free.push_back(successor);
+        } else {
+            *link = (m_nodes[node].m_left == NONE) ? m_nodes[node].m_right : m_nodes[node].m_left;
+            m_free.push_back(node);
+        }
+        retrace(path, depth);
+    }
+    uint64_t levels() const {return m_levels;}
+
+private:
+    static const uint32_t NONE = 0;
+    static const int MAXHEIGHT = 64;
+    struct Node{
+        int m_id;
+        uint32_t m_left;
+        uint32_t m_right;
+        int m_height;
+    };
+    std::vector<Node> m_nodes;          // slot 0 is NONE, of height 0
+    std::vector<uint32_t> m_free;
+    uint32_t m_root;
+    bool m_fullPath;
+    uint64_t m_levels;
+
+    void update(uint32_t node) {
+        Node& n = m_nodes[node];
+        n.m_height = 1 + std::max(m_nodes[n.m_left].m_height, m_nodes[n.m_right].m_height);
+    }
+    uint32_t rotateRight(uint32_t node) {
+        uint32_t left = m_nodes[node].m_left;
+        m_nodes[node].m_left = m_nodes[left].m_right;
+        m_nodes[left].m_right = node;
+        update(node);
+        update(left);
+        return left;
+    }
+    uint32_t rotateLeft(uint32_t node) {
+        uint32_t right = m_nodes[node].m_right;
+        m_nodes[node].m_right = m_nodes[right].m_left;
+        m_nodes[right].m_left = node;
+        update(node);
+        update(right);
+        return right;
+    }
+    int balanceOf(uint32_t node) const {
+        return m_nodes[m_nodes[node].m_left].m_height - m_nodes[m_nodes[node].m_right].m_height;
+    }
+    uint32_t balance(uint32_t node) {
+        int factor = balanceOf(node);
+        if (factor > 1) {
+            if (balanceOf(m_nodes[node].m_left) < 0) {
+                m_nodes[node].m_left = rotateLeft(m_nodes[node].m_left);
+            }
+            return rotateRight(node);
+        }
+        if (factor < -1) {
+            if (balanceOf(m_nodes[node].m_right) > 0) {
+                m_nodes[node].m_right = rotateRight(m_nodes[node].m_right);
+            }
+            return rotateLeft(node);
+        }
+        return node;
+    }
+    void retrace(uint32_t* path[], int depth) {
+        for (int i = depth - 1; i >= 0; i--) {
+            uint32_t node = *path[i];
+            int oldHeight = m_nodes[node].m_height;
+            update(node);
+            uint32_t top = balance(node);
+            *path[i] = top;
+            m_levels++;
+            if (!m_fullPath && m_nodes[top].m_height == oldHeight) {
+                break;
+            }
+        }
+    }
+};
+
+// BENCH 5: steady-state churn, one removal and one insert per step on a tree of n
+// Most retraces stop within a level or two of the leaf, so this is where the
+// early exit in SatNet::retrace shows up. The ChurnTree rows run the same
+// steps with and without the early exit and print the levels each retraced.
+void Bench::benchChurn(int n) {
+    std::vector<int> ids = shuffledIDs(std::min(2 * n, MAXID - MINID + 1));
+    SatNet satNet;
+    for (int i = 0; i < n; i++) {
+        satNet.insert(Sat(ids[i]));
+    }
+
+    // replace the oldest satellite with a fresh ID, cycling through the pool
+    // of IDs; when the pool is no larger than the tree the "fresh" ID is the
+    // one just removed
+    int steps = 4 * n;
+    size_t oldest = 0;
+    size_t next = n % ids.size();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) {
+        satNet.tryRemove(ids[oldest]);
+        satNet.tryInsert(Sat(ids[next]));
+        oldest = (oldest + 1) % ids.size();
+        next = (next + 1) % ids.size();
+    }
+    report("churn remove+insert", steps, elapsedMs(start));
+
+    const char* const names[] = {"churn, early-exit retrace", "churn, full-path retrace"};
+    uint64_t levels[2];
+    for (int fullPath = 0; fullPath < 2; fullPath++) {
+        ChurnTree tree(n, fullPath != 0);
+        for (int i = 0; i < n; i++) {
+            tree.insert(ids[i]);
+        }
+        oldest = 0;
+        next = n % ids.size();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < steps; i++) {
+            tree.remove(ids[oldest]);
+            tree.insert(ids[next]);
+            oldest = (oldest + 1) % ids.size();
+            next = (next + 1) % ids.size();
+        }
+        report(names[fullPath], steps, elapsedMs(start));
+        levels[fullPath] = tree.levels();
+    }
+    std::cout << "  levels retraced per step: " << std::setprecision(2) << (double)levels[0] / steps
+              << " with the early exit, " << (double)levels[1] / steps << " on the full path" << std::endl;
+}
+
+// BENCH 6: removeDeorbited sweep after a decommission campaign
+void Bench::benchRemoveDeorbited(int n) {
+    std::vector<int> ids = shuffledIDs(n);
+    SatNet satNet;
+    for (int i = 0; i < n; i++) {
+        satNet.insert(Sat(ids[i]));
+    }
+    // a third of the fleet is retired
+    for (int i = 0; i < n; i += 3) {
+        satNet.setState(ids[i], DEORBITED);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int removed = satNet.removeDeorbited();
+    report("removeDeorbited (1/3 of fleet)", n, elapsedMs(start));
+
+    if (removed != (n + 2) / 3) {
+        std::cout << "unexpected: " << removed << " removed" << std::endl;
+    }
+}
+
+// BENCH 7: random lookups, AVL tree versus frozen Eytzinger snapshot
+// The lookup rows follow the freezeSnapshot row for the same fleet size; the
+// query IDs are spread over the whole range, so about n / 90000 of them hit.
+void Bench::benchSnapshot(int n) {
+    std::vector<int> ids = shuffledIDs(MAXID - MINID + 1);
+    SatNet satNet;
+    for (int i = 0; i < n; i++) {
+        satNet.insert(Sat(ids[i]));
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SatSnapshot snapshot = satNet.freezeSnapshot();
+    report("freezeSnapshot", n, elapsedMs(start));
+
+    std::mt19937 generator(20);
+    std::uniform_int_distribution<int> distribution(MINID, MAXID);
+    std::vector<int> queries(1000000);
+    for (size_t i = 0; i < queries.size(); i++) {
+        queries[i] = distribution(generator);
+    }
+    int count = (int)queries.size();
+
+    int found = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        found += satNet.findSatellite(queries[i]);
+    }
+    report("tree findSatellite (random)", count, elapsedMs(start));
+
+    int frozen = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        frozen += snapshot.findSatellite(queries[i]);
+    }
+    report("snapshot findSatellite (random)", count, elapsedMs(start));
+
+    if (found != frozen) {
+        std::cout << "unexpected: " << found << " != " << frozen << std::endl;
+    }
+}
+
+// BENCH 8: batched findSatellites and setStates versus one call per ID
+// Each row follows the tree build for the same fleet size; the queries are
+// random IDs of satellites in the fleet, so every lookup walks to a node.
+void Bench::benchBatchedLookup(int n) {
+    std::vector<int> ids = shuffledIDs(n);
+    SatNet satNet;
+    for (int i = 0; i < n; i++) {
+        satNet.insert(Sat(ids[i]));
+    }
+
+    std::mt19937 generator(30);
+    std::uniform_int_distribution<int> distribution(0, n - 1);
+    std::vector<int> queries(1000000);
+    std::vector<STATE> states(queries.size());
+    for (size_t i = 0; i < queries.size(); i++) {
+        queries[i] = ids[distribution(generator)];
+        states[i] = (STATE)(i % NUMSTATES);
+    }
+    int count = (int)queries.size();
+    bool* out = new bool[count];
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        out[i] = satNet.findSatellite(queries[i]);
+    }
+    report("findSatellite (n=" + std::to_string(n) + ")", count, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    satNet.findSatellites(queries.data(), count, out);
+    report("findSatellites batch", count, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        out[i] = satNet.setState(queries[i], states[i]);
+    }
+    report("setState", count, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    satNet.setStates(queries.data(), states.data(), count, out);
+    report("setStates batch", count, elapsedMs(start));
+
+    int found = 0;
+    for (int i = 0; i < count; i++) {
+        found += out[i];
+    }
+    if (found != count) {
+        std::cout << "unexpected: " << found << " found" << std::endl;
+    }
+    delete[] out;
+}
+
+// BENCH 9: ConcurrentSatNet lookups from several reader threads while one writer churns
+// The fleet holds 45,000 satellites. Every reader does the same number of
+// lookups under the shared lock, so the rows show total lookups per second as
+// readers are added. The writer's rate is reported too, since a reader-heavy
+// lock can starve it.
+void Bench::benchConcurrentReads(int readers) {
+    int n = 45000;
+    std::vector<int> ids = shuffledIDs(MAXID - MINID + 1);
+    ConcurrentSatNet fleet;
+    for (int i = 0; i < n; i++) {
+        fleet.insert(Sat(ids[i]));
+    }
+
+    int lookups = 500000;
+    std::atomic<bool> reading(true);
+    std::atomic<int> writes(0);
+    // replaces the oldest satellite with a fresh ID, like BENCH 5
+    std::thread writer([&fleet, &ids, &reading, &writes, n]() {
+        size_t oldest = 0;
+        size_t next = n;
+        while (reading) {
+            fleet.tryRemove(ids[oldest]);
+            fleet.tryInsert(Sat(ids[next]));
+            oldest = (oldest + 1) % ids.size();
+            next = (next + 1) % ids.size();
+            writes++;
+        }
+    });
+
+    std::vector<std::thread> threads;
+    std::atomic<int> found(0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < readers; r++) {
+        threads.push_back(std::thread([&fleet, &found, lookups, r]() {
+            std::mt19937 generator(40 + r);
+            std::uniform_int_distribution<int> distribution(MINID, MAXID);
+            int hits = 0;
+            for (int i = 0; i < lookups; i++) {
+                hits += fleet.findSatellite(distribution(generator));
+            }
+            found += hits;
+        }));
+    }
+    for (size_t r = 0; r < threads.size(); r++) {
+        threads[r].join();
+    }
+    double ms = elapsedMs(start);
+    reading = false;
+    writer.join();
+
+    report("locked find, " + std::to_string(readers) + (readers == 1 ? " reader" : " readers"), readers * lookups, ms);
+    report("  writer churn alongside", writes, ms);
+}
+
+// BENCH 10: setState from several threads, SatNet behind one mutex versus lock-free ConcurrentSatNet
+// Each thread sets random states on random satellites of a 45,000 fleet.
+void Bench::benchConcurrentStates(int threads) {
+    int n = 45000;
+    std::vector<int> ids = shuffledIDs(n);
+    SatNet satNet;
+    std::mutex mutex;
+    ConcurrentSatNet fleet;
+    for (int i = 0; i < n; i++) {
+        satNet.insert(Sat(ids[i]));
+        fleet.insert(Sat(ids[i]));
+    }
+
+    int updates = 500000;
+    std::string suffix = ", " + std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+    for (int lockFree = 0; lockFree < 2; lockFree++) {
+        std::vector<std::thread> workers;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int t = 0; t < threads; t++) {
+            workers.push_back(std::thread([&satNet, &mutex, &fleet, &ids, updates, lockFree, t]() {
+                std::mt19937 generator(50 + t);
+                std::uniform_int_distribution<int> distribution(0, (int)ids.size() - 1);
+                for (int i = 0; i < updates; i++) {
+                    int id = ids[distribution(generator)];
+                    STATE state = (STATE)(i % NUMSTATES);
+                    if (lockFree) {
+                        fleet.setState(id, state);
+                    } else {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        satNet.setState(id, state);
+                    }
+                }
+            }));
+        }
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+        report(std::string(lockFree ? "lock-free setState" : "mutex setState") + suffix,
+               threads * updates, elapsedMs(start));
+    }
+}
+
+// BENCH 11: keeping 100 versions of a changing fleet, deep copies versus PersistentSatNet snapshots
+// Between versions, 10 satellites change state. The memory rows count the
+// node arrays of the copies and the nodes the snapshots added, plus the
+// control block make_shared puts in front of every persistent node.
+void Bench::benchVersions(int n) {
+    std::vector<int> ids = shuffledIDs(n);
+    SatNet satNet;
+    for (int i = 0; i < n; i++) {
+        satNet.insert(Sat(ids[i]));
+    }
+    PersistentSatNet current(satNet);
+
+    int versions = 100;
+    int changes = 10;
+    std::vector<SatNet> copies;
+    copies.reserve(versions);
+    double copyMs = 0;
+    for (int v = 0; v < versions; v++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        copies.push_back(satNet);
+        copyMs += elapsedMs(start);
+        for (int c = 0; c < changes; c++) {
+            satNet.setState(ids[(v * changes + c) % n], (STATE)(v % NUMSTATES));
+        }
+    }
+    report("deep copy (n=" + std::to_string(n) + ")", versions, copyMs);
+    reportMemory("  copies hold", versions, (size_t)versions * n * (sizeof(SatNode) + sizeof(SatCounts)));
+
+    long before = PersistentNode::live();
+    std::vector<PersistentSatNet> snapshots;
+    snapshots.reserve(versions);
+    double snapshotMs = 0;
+    double updateMs = 0;
+    for (int v = 0; v < versions; v++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        snapshots.push_back(current.snapshot());
+        snapshotMs += elapsedMs(start);
+        start = std::chrono::steady_clock::now();
+        for (int c = 0; c < changes; c++) {
+            current.setState(ids[(v * changes + c) % n], (STATE)(v % NUMSTATES));
+        }
+        updateMs += elapsedMs(start);
+    }
+    report("persistent snapshot", versions, snapshotMs);
+    report("  persistent setState", versions * changes, updateMs);
+    reportMemory("  snapshots add", versions, (PersistentNode::live() - before) * (sizeof(PersistentNode) + 16));
+}
+
+// BENCH 12: bulkLoad and copyFrom of a full fleet split across SatWorkers threads
+// Every possible ID in random order; the 1-thread rows are the serial paths.
+void Bench::benchParallelBuild(int threads) {
+    int n = MAXID - MINID + 1;
+    std::vector<int> ids = shuffledIDs(n);
+    std::vector<Sat> batch;
+    for (int i = 0; i < n; i++) {
+        batch.push_back(Sat(ids[i], (ALT)(i % NUMALTS)));
+    }
+    SatWorkers workers(threads);
+    std::string suffix = ", " + std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+
+    SatNet satNet;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    satNet.bulkLoad(batch, workers);
+    report("bulkLoad" + suffix, n, elapsedMs(start));
+
+    SatNet copy;
+    start = std::chrono::steady_clock::now();
+    copy.copyFrom(satNet, workers);
+    report("copyFrom" + suffix, n, elapsedMs(start));
+}
+
+// BENCH 13: fleet-wide histogram and filtered ID list split across SatWorkers threads
+// A full fleet with mixed attributes; the 1-thread rows are a single in-order walk.
+void Bench::benchParallelQuery(int threads) {
+    int n = MAXID - MINID + 1;
+    std::vector<int> ids = shuffledIDs(n);
+    std::vector<Sat> batch;
+    for (int i = 0; i < n; i++) {
+        batch.push_back(Sat(ids[i], (ALT)(i % NUMALTS), (INCLIN)(i / 7 % NUMINCLINS), (STATE)(i / 3 % NUMSTATES)));
+    }
+    SatNet satNet;
+    satNet.bulkLoad(batch);
+    SatWorkers workers(threads);
+    SatQuery query(satNet, workers);
+    std::string suffix = ", " + std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SatHistogram histogram = query.histogram();
+    report("histogram" + suffix, histogram.total(), elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    std::vector<int> decaying = query.findIDs(SatFilter::state(DECAYING) & SatFilter::alt(MI208));
+    report("findIDs" + suffix, n, elapsedMs(start));
+}
+
+// BENCH 14: IDs with two given attributes, attribute index versus a walk of the tree
+// "every DECAYING satellite at MI340", about one in twelve of the fleet.
+void Bench::benchAttributeIndex(int n) {
+    std::vector<int> ids = shuffledIDs(n);
+    SatNet satNet;
+    for (int i = 0; i < n; i++) {
+        satNet.insert(Sat(ids[i], (ALT)(i % NUMALTS), (INCLIN)(i / 7 % NUMINCLINS), (STATE)(i / 3 % NUMSTATES)));
+    }
+    const int rounds = 100;
+
+    SatWorkers workers(1);
+    SatQuery query(satNet, workers);
+    SatFilter filter = SatFilter::state(DECAYING) & SatFilter::alt(MI340);
+    size_t found = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        found += query.findIDs(filter).size();
+    }
+    report("attribute filter, tree walk", n, elapsedMs(start) / rounds);
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        found += (satNet.getIDs(DECAYING) & satNet.getIDs(MI340)).ids().size();
+    }
+    report("attribute filter, index", n, elapsedMs(start) / rounds);
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        found += (satNet.getIDs(DECAYING) & satNet.getIDs(MI340)).size();
+    }
+    report("attribute count, index", n, elapsedMs(start) / rounds);
+    if (found == 0) {
+        std::cout << "no satellite matched" << std::endl;
+    }
+}
+
+// BENCH 15: a report on one block of 1,000 IDs, whole-tree walk versus range iteration
+// The fleet fills [MINID, MINID + n), so the block holds 1,000 satellites;
+// each row counts the DECAYING ones.
+void Bench::benchBlockReport(int n) {
+    std::vector<int> ids = shuffledIDs(n);
+    SatNet satNet;
+    for (int i = 0; i < n; i++) {
+        satNet.insert(Sat(ids[i], MI208, I48, (STATE)(i % NUMSTATES)));
+    }
+    int minID = MINID + n / 2 - 500;
+    int maxID = minID + 999;
+    const int rounds = 100;
+    int decaying = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (SatNet::const_iterator it = satNet.begin(); it != satNet.end(); ++it) {
+            if (it.getID() >= minID && it.getID() <= maxID && (*it).getState() == DECAYING) {
+                decaying++;
+            }
+        }
+    }
+    report("block report, whole tree", 1000, elapsedMs(start) / rounds);
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        SatNet::const_iterator last = satNet.upper_bound(maxID);
+        for (SatNet::const_iterator it = satNet.lower_bound(minID); it != last; ++it) {
+            decaying += ((*it).getState() == DECAYING);
+        }
+    }
+    report("block report, lower_bound", 1000, elapsedMs(start) / rounds);
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        satNet.forEachInRange(minID, maxID, [&decaying](const Sat& satellite) {
+            decaying += (satellite.getState() == DECAYING);
+        });
+    }
+    report("block report, forEachInRange", 1000, elapsedMs(start) / rounds);
+    if (decaying == 0) {
+        std::cout << "no satellite matched" << std::endl;
+    }
+}
+
+// BENCH 16: listing the fleet, a flushed line per satellite versus one SatWriter buffer
+// Everything goes to /dev/null, so the rows time the formatting and the
+// system calls, not a terminal. The first row is the old listSatellites loop.
+void Bench::benchListing(int n) {
+    std::vector<int> ids = shuffledIDs(n);
+    SatNet satNet;
+    for (int i = 0; i < n; i++) {
+        satNet.insert(Sat(ids[i], (ALT)(i % NUMALTS), (INCLIN)(i / 7 % NUMINCLINS), (STATE)(i / 3 % NUMSTATES)));
+    }
+    std::vector<Sat> satellites;
+    for (SatNet::const_iterator it = satNet.begin(); it != satNet.end(); ++it) {
+        satellites.push_back(*it);
+    }
+
+    std::ofstream null("/dev/null");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < satellites.size(); i++) {
+        const Sat& satellite = satellites[i];
+        null << satellite.getID() << ": " << satellite.getStateStr() << ": " << satellite.getInclinStr() << ": "
+             << satellite.getAltStr() << endl;
+    }
+    report("list, endl per line", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    {
+        SatWriter out(null);
+        satNet.listSatellites(out);
+    }
+    report("list, SatWriter on ofstream", n, elapsedMs(start));
+
+    int fd = open("/dev/null", O_WRONLY);
+    FORMAT formats[] = {TEXT, CSV, JSONL};
+    const char* names[] = {"list, SatWriter on fd", "list CSV, SatWriter on fd", "list JSONL, SatWriter on fd"};
+    for (int f = 0; f < 3; f++) {
+        start = std::chrono::steady_clock::now();
+        {
+            SatWriter out(fd);
+            satNet.listSatellites(out, formats[f]);
+        }
+        report(names[f], n, elapsedMs(start));
+    }
+    close(fd);
+}
+
+// BENCH 17: restarting with a fleet, inserts one by one versus a binary snapshot file
+// The file is written once and read back while it is in the page cache, so
+// the load rows time mapping, checking and building, not the disk.
+void Bench::benchRestart(int n) {
+    std::vector<int> ids = shuffledIDs(n);
+    std::vector<Sat> batch;
+    for (int i = 0; i < n; i++) {
+        batch.push_back(Sat(ids[i], (ALT)(i % NUMALTS), (INCLIN)(i / 7 % NUMINCLINS), (STATE)(i / 3 % NUMSTATES)));
+    }
+    std::string path = "/tmp/satbench" + std::to_string(getpid()) + ".sat";
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SatNet inserted;
+    for (int i = 0; i < n; i++) {
+        inserted.insert(batch[i]);
+    }
+    report("restart, insert one by one", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    inserted.saveSnapshot(path);
+    report("saveSnapshot", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    SatNet loaded;
+    loaded.loadSnapshot(path);
+    report("restart, loadSnapshot", n, elapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    SatImage image(path);
+    bool found = image.findSatellite(ids[0]);
+    report("restart, SatImage in place", n, elapsedMs(start));
+    unlink(path.c_str());
+    if (!found) {
+        std::cout << "snapshot lost a satellite" << std::endl;
+    }
+}
+
+// BENCH 18: setState with a journal, by group size, and replaying the journal
+// A fleet of 10,000 takes 20,000 state changes; each group costs one
+// fdatasync, so the rows depend on the disk under /tmp.
+void Bench::benchJournal(int groupSize) {
+    int n = 10000;
+    int changes = 20000;
+    std::string base = "/tmp/satbench" + std::to_string(getpid());
+    std::string snapshot = base + ".sat";
+    std::string journal = base + ".log";
+    std::string suffix = ", group " + std::to_string(groupSize);
+    {
+        SatNet satNet;
+        for (int i = 0; i < n; i++) {
+            satNet.insert(Sat(MINID + i));
+        }
+        satNet.saveSnapshot(snapshot);
+        unlink(journal.c_str());
+    }
+    {
+        JournaledSatNet fleet(snapshot, journal, groupSize);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < changes; i++) {
+            fleet.setState(MINID + i % n, (STATE)(i % NUMSTATES));
+        }
+        fleet.commit();
+        report("journaled setState" + suffix, changes, elapsedMs(start));
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    JournaledSatNet recovered(snapshot, journal, groupSize);
+    report("snapshot + replay" + suffix, recovered.replayed(), elapsedMs(start));
+    unlink(snapshot.c_str());
+    unlink(journal.c_str());
+}
+
+// BENCH 19: loading a catalog, getline and stringstream with one insert per line versus SatIngest
+// A replay catalog: random lines over the whole ID range, so past the first
+// ~90,000 distinct IDs most lines repeat one already loaded. The stream
+// baseline only runs up to a million lines.
+void Bench::benchIngest(int lines) {
+    std::string path = "/tmp/satbench" + std::to_string(getpid()) + ".csv";
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        SatWriter out(fd);
+        std::mt19937 gen(19);
+        std::uniform_int_distribution<int> idDist(MINID, MAXID);
+        out.writeHeader(CSV);
+        for (int i = 0; i < lines; i++) {
+            unsigned attr = gen();
+            out.writeSatellite(idDist(gen), (ALT)(attr & 3), (INCLIN)(attr >> 2 & 3), (STATE)((attr >> 4) % NUMSTATES), CSV);
+        }
+        out.flush();
+        close(fd);
+    }
+    // read once so both runs start from the page cache
+    {
+        std::ifstream warm(path, std::ios::binary);
+        std::vector<char> chunk(1 << 20);
+        while (warm.read(chunk.data(), chunk.size()) || warm.gcount() > 0) {
+        }
+    }
+    std::string suffix = ", " + std::to_string(lines / 1000) + "k lines";
+    if (lines <= 1000000) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        SatNet satNet;
+        std::ifstream in(path);
+        std::string line, field;
+        std::getline(in, line);
+        while (std::getline(in, line)) {
+            std::stringstream fields(line);
+            std::getline(fields, field, ',');
+            int id = std::stoi(field);
+            std::getline(fields, field, ',');
+            STATE state = field == "Active" ? ACTIVE : field == "Deorbited" ? DEORBITED : DECAYING;
+            int inclin, alt;
+            char comma;
+            fields >> inclin >> comma >> alt;
+            satNet.tryInsert(Sat(id, alt == 208 ? MI208 : alt == 215 ? MI215 : alt == 340 ? MI340 : MI350,
+                                 inclin == 48 ? I48 : inclin == 53 ? I53 : inclin == 70 ? I70 : I97, state));
+        }
+        report("stream + insert" + suffix, lines, elapsedMs(start));
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SatNet satNet;
+    SatIngest().load(path, satNet);
+    report("SatIngest" + suffix, lines, elapsedMs(start));
+    unlink(path.c_str());
+}
+
+// BENCH 20: latency percentiles and rate of each operation, by ID workload and size
+std::vector<int> Bench::workloadIDs(WORKLOAD workload, int n) {
+    std::vector<int> ids;
+    std::mt19937 gen(20);
+    if (workload == SEQUENTIAL) {
+        for (int i = 0; i < n; i++) {
+            ids.push_back(MINID + i);
+        }
+    } else if (workload == RANDOMIDS) {
+        // n distinct IDs spread over the whole range, in random order
+        std::vector<int> all;
+        for (int id = MINID; id <= MAXID; id++) {
+            all.push_back(id);
+        }
+        std::shuffle(all.begin(), all.end(), gen);
+        ids.assign(all.begin(), all.begin() + n);
+    } else {
+        // runs of 64 consecutive IDs, the runs in random order
+        const int RUN = 64;
+        std::vector<int> runs;
+        for (int start = MINID; start <= MAXID; start += RUN) {
+            runs.push_back(start);
+        }
+        std::shuffle(runs.begin(), runs.end(), gen);
+        for (size_t r = 0; (int)ids.size() < n; r++) {
+            for (int i = 0; i < RUN && runs[r] + i <= MAXID && (int)ids.size() < n; i++) {
+                ids.push_back(runs[r] + i);
+            }
+        }
+    }
+    return ids;
+}
+
+template <class Operation>
+double Bench::timeEach(int count, std::vector<double>& samples, Operation operation) {
+    Clock::time_point first = Clock::now();
+    Clock::time_point last = first;
+    for (int i = 0; i < count; i++) {
+        operation(i);
+        Clock::time_point now = Clock::now();
+        samples.push_back(std::chrono::duration<double, std::nano>(now - last).count());
+        last = now;
+    }
+    return std::chrono::duration<double, std::nano>(last - first).count();
+}
+
+template <class Trial>
+void Bench::measure(const std::string& name, WORKLOAD workload, int n, Trial trial, int trials) {
+    std::vector<double> samples;
+    trial(samples);
+    samples.clear();
+    std::vector<double> rates;
+    double totalNs = 0;
+    for (int t = 0; t < trials; t++) {
+        size_t before = samples.size();
+        double ns = trial(samples);
+        totalNs += ns;
+        rates.push_back(ns > 0 ? (samples.size() - before) / ns * 1e9 : 0.0);
+    }
+    std::sort(samples.begin(), samples.end());
+    std::sort(rates.begin(), rates.end());
+    double p50 = samples[(samples.size() - 1) / 2];
+    double p99 = samples[(samples.size() - 1) * 99 / 100];
+    double opsPerSec = rates[rates.size() / 2];
+    std::string row = name + ", " + WORKLOADNAMES[workload];
+    std::cout << std::left << std::setw(32) << row << std::setw(10) << n << std::fixed << std::setprecision(0)
+              << std::setw(12) << p50 << std::setw(12) << p99 << opsPerSec << std::endl;
+    m_results.push_back(Result{name, WORKLOADNAMES[workload], n, totalNs / 1e6 / trials, opsPerSec, p50, p99, -1});
+}
+
+// Each call is timed on its own, so a sample is one operation plus one clock
+// read (see benchClock). countSatellites is the O(log n) count over the
+// 1,000 IDs from each ID. The tree for find, setState, countSatellites and
+// remove is built in the workload's order, outside the timing; remove,
+// removeDeorbited and copy work on a fresh copy every trial. removeDeorbited
+// and copy are one sample per trial, so they run more trials.
+void Bench::benchLatency(WORKLOAD workload, int n) {
+    std::vector<int> ids = workloadIDs(workload, n);
+    SatNet built;
+    for (int i = 0; i < n; i++) {
+        built.insert(Sat(ids[i], (ALT)(i % NUMALTS), (INCLIN)(i / 4 % NUMINCLINS), (STATE)(i % NUMSTATES)));
+    }
+    long sink = 0;
+
+    measure("insert", workload, n, [&](std::vector<double>& samples) {
+        SatNet satNet;
+        return timeEach(n, samples, [&](int i) {
+            satNet.insert(Sat(ids[i]));
+        });
+    });
+    measure("find", workload, n, [&](std::vector<double>& samples) {
+        return timeEach(n, samples, [&](int i) {
+            sink += built.findSatellite(ids[i]);
+        });
+    });
+    measure("setState", workload, n, [&](std::vector<double>& samples) {
+        return timeEach(n, samples, [&](int i) {
+            sink += built.setState(ids[i], (STATE)(i % NUMSTATES));
+        });
+    });
+    measure("countSatellites", workload, n, [&](std::vector<double>& samples) {
+        return timeEach(n, samples, [&](int i) {
+            sink += built.countSatellites((INCLIN)(i % NUMINCLINS), ids[i], ids[i] + 999);
+        });
+    });
+    measure("remove", workload, n, [&](std::vector<double>& samples) {
+        SatNet satNet(built);
+        return timeEach(n, samples, [&](int i) {
+            satNet.remove(ids[i]);
+        });
+    });
+    measure("removeDeorbited", workload, n, [&](std::vector<double>& samples) {
+        SatNet satNet(built);
+        return timeEach(1, samples, [&](int) {
+            sink += satNet.removeDeorbited();
+        });
+    }, 5 * TRIALS);
+    measure("copy", workload, n, [&](std::vector<double>& samples) {
+        std::unique_ptr<SatNet> copy;
+        return timeEach(1, samples, [&](int) {
+            copy.reset(new SatNet(built));
+        });
+    }, 5 * TRIALS);
+    if (sink == 0) {
+        std::cerr << "latency benchmark found nothing" << std::endl;
+    }
+}
+
+void Bench::benchClock() {
+    const int READS = 1000000;
+    std::vector<double> samples;
+    samples.reserve(READS);
+    double ns = timeEach(READS, samples, [](int) {});
+    std::cout << std::left << std::setw(32) << "clock read" << std::setw(10) << READS << std::fixed
+              << std::setprecision(1) << ns / READS << " ns each" << std::endl;
+    m_results.push_back(Result{"clock read", "", READS, ns / 1e6, READS / ns * 1e9, ns / READS, ns / READS, -1});
+}
+
+// {"results": [{"name": ..., "workload": ..., "n": ..., "ms": ..., ...}, ...]};
+// fields that do not apply to a row are left out
+bool Bench::writeJSON(const std::string& path) const {
+    std::ofstream out(path);
+    out << std::fixed << std::setprecision(3) << "{\"threads\": " << std::thread::hardware_concurrency()
+        << ", \"results\": [";
+    for (size_t i = 0; i < m_results.size(); i++) {
+        const Result& result = m_results[i];
+        out << (i == 0 ? "\n" : ",\n") << "  {\"name\": \"";
+        for (char c : result.m_name) {
+            if (c == '"' || c == '\\') {
+                out << '\\';
+            }
+            out << c;
+        }
+        out << "\"";
+        if (!result.m_workload.empty()) {
+            out << ", \"workload\": \"" << result.m_workload << "\"";
+        }
+        out << ", \"n\": " << result.m_n;
+        if (result.m_ms >= 0) {
+            out << ", \"ms\": " << result.m_ms;
+        }
+        if (result.m_opsPerSec >= 0) {
+            out << ", \"ops_per_sec\": " << result.m_opsPerSec;
+        }
+        if (result.m_p50Ns >= 0) {
+            out << ", \"p50_ns\": " << result.m_p50Ns << ", \"p99_ns\": " << result.m_p99Ns;
+        }
+        if (result.m_kb >= 0) {
+            out << ", \"kb\": " << result.m_kb;
+        }
+        out << "}";
+    }
+    out << "\n]}\n";
+    out.close();
+    if (!out) {
+        std::cerr << "could not write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// BENCH 21: SatNet versus BalancedIndex instantiations on the same IDs
+// The index stores the attributes as one packed byte; the 16-bit rows key by
+// ID - MINID, which fits while n stays under 65,536.
+template <class Index, class Key>
+double Bench::timeIndex(Index& index, const std::vector<int>& ids, int offset, int& found) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ids.size(); i++) {
+        index.tryInsert((Key)(ids[i] - offset), (uint8_t)i);
+    }
+    for (size_t i = 0; i < ids.size(); i++) {
+        found += index.contains((Key)(ids[i] - offset));
+    }
+    std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+void Bench::benchBalancedIndex(int n) {
+    std::vector<int> ids = shuffledIDs(n);
+    int found = 0;
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        SatNet satNet;
+        for (int i = 0; i < n; i++) {
+            satNet.tryInsert(Sat(ids[i]));
+        }
+        for (int i = 0; i < n; i++) {
+            found += satNet.findSatellite(ids[i]);
+        }
+        report("SatNet insert+find", 2 * n, elapsedMs(start));
+    }
+    {
+        BalancedIndex<int, uint8_t> index;
+        report("BalancedIndex<int> insert+find", 2 * n, timeIndex<BalancedIndex<int, uint8_t>, int>(index, ids, 0, found));
+    }
+    if (n <= 65536) {
+        BalancedIndex<uint16_t, uint8_t> index;
+        report("BalancedIndex<u16> insert+find", 2 * n,
+               timeIndex<BalancedIndex<uint16_t, uint8_t>, uint16_t>(index, ids, MINID, found));
+    }
+    if (found == 0) {
+        std::cerr << "balanced index benchmark found nothing" << std::endl;
+    }
+}
@@ -1,9 +1,30 @@
 // UMBC - CMSC 341 - Fall 2023 - Proj2
 #include "satnet.h"
+#include "sattable.h"
+#include "satsnapshot.h"
+#include "concurrentsatnet.h"
+#include "persistentsatnet.h"
+#include "satworkers.h"
+#include "satquery.h"
+#include "satwriter.h"
+#include "satimage.h"
+#include "satjournal.h"
+#include "satingest.h"
+#include "balancedindex.h"
 #include <math.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
 #include <random>
+#include <sstream>
+#include <thread>
 #include <vector>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 enum RANDOM {UNIFORMINT, UNIFORMREAL, NORMAL, SHUFFLE};
 class Random {
@@ -145,6 +166,52 @@ public:
     bool testRemoveTimeComplexity(SatNet& satNet, int n = 1000);
     // TEST 17: Prove that the insertion performs in O(log n).
     bool testInsertTimeComplexity(SatNet& satNet, int n = 1000);
+    // TEST 18: Test that clear() releases the whole pool and the tree can be rebuilt from it.
+    bool testClearAndReuse(SatNet& satNet, int n = 300);
+    // TEST 19: Test the subtree counts after insertions, state changes and removals, over whole tree and ID ranges.
+    bool testCountSatellitesInRange(SatNet& satNet, int n = 500);
+    // TEST 20: Test that the direct-indexed SatTable answers exactly like SatNet for the same operations.
+    bool testTableMatchesTree(SatNet& satNet, SatTable& satTable, int n = 2000);
+    // TEST 21: Test bulkLoad(...) and bulkMerge(...) with duplicates and out-of-range IDs in the batch.
+    bool testBulkLoad(SatNet& satNet, int n = 1000);
+    // TEST 22: Test the outcomes reported by tryInsert(...) and tryRemove(...).
+    bool testTryInsertRemove(SatNet& satNet, int n = 300);
+    // TEST 23: Test removeIf(...) and the count returned by removeDeorbited().
+    bool testRemoveIf(SatNet& satNet, int n = 1000);
+    // TEST 24: Test that freezeSnapshot() answers like the tree and does not change with it.
+    bool testFreezeSnapshot(SatNet& satNet, int n = 3000);
+    // TEST 25: Test that findSatellites(...) and setStates(...) match the one-at-a-time calls.
+    bool testBatchedLookup(SatNet& satNet, int n = 2000);
+    // TEST 26: Test ConcurrentSatNet readers against writers churning the tree.
+    bool testConcurrentSatNet(ConcurrentSatNet& fleet, int n = 2000);
+    // TEST 27: Test lock-free setState/getState against each other and against structural writers.
+    bool testLockFreeStates(ConcurrentSatNet& fleet, int n = 5000);
+    // TEST 28: Test that PersistentSatNet versions are independent, balanced and share their nodes.
+    bool testPersistentSatNet(int n = 2000);
+    // TEST 29: Test the copy constructor, move constructor, move assignment and swap.
+    bool testMoveAndSwap(SatNet& satNet, int n = 500);
+    // TEST 30: Test that bulk loads, merges and copies split across SatWorkers match the serial ones.
+    bool testParallelBuild(int n = 30000);
+    // TEST 31: Test SatQuery histograms, counts and ID lists against a plain walk of the fleet.
+    bool testParallelQuery(SatNet& satNet, int n = 20000);
+    // TEST 32: Test that the attribute index follows every kind of change to the tree.
+    bool testAttributeIndex(SatNet& satNet, int n = 3000);
+    // TEST 33: Test in-order iterators, lower_bound/upper_bound/equal_range and forEachInRange(...).
+    bool testIterators(SatNet& satNet, int n = 2000);
+    // TEST 34: Test buffered listSatellites(...) and dumpTree(...) in every format and to every kind of sink.
+    bool testListingOutput(SatNet& satNet, int n = 3000);
+    // TEST 35: Test saveSnapshot/loadSnapshot round trips, in-place SatImage lookups and damaged files.
+    bool testSnapshotFile(SatNet& satNet, int n = 5000);
+    // TEST 36: Test JournaledSatNet recovery: replay, checkpoints, torn groups, stale logs and group commit.
+    bool testJournal(int n = 4000);
+    // TEST 37: Test SatIngest: CSV round trips, column headers, bad lines, duplicates and chunk boundaries.
+    bool testIngest(SatNet& satNet, int n = 5000);
+    // TEST 38: Test SatNet::stats(): rotations, descents, pool traffic, retraces, latencies and reset.
+    bool testStats(SatNet& satNet, int n = 4096);
+    // TEST 39: Test BalancedIndex with 16-bit and 32-bit keys, a struct payload and a reversed order against std::map.
+    bool testBalancedIndex(int n = 20000);
+    // TEST 40: Test every ConcurrentSatNet read against structural writers; run it under ThreadSanitizer.
+    bool testConcurrentReadWrite(ConcurrentSatNet& fleet, int n = 3000);
 
 private:
     // TEST Helpers
@@ -154,6 +221,23 @@ private:
     std::vector<int> removeNSatellites(SatNet& satNet, int n);
     // measureTime by SatNet, Operation and int number of elements
     double measureTime(SatNet& satNet, MEASURE_TIME_OPERATION op, int n);
+    // check every node: stored height is right and balance is within [-1, 1]
+    bool checkAVL(const SatNet& satNet, SatIndex node, int& height);
+    // the same checks for a BalancedIndex, plus the key order
+    template <class Index>
+    bool checkBalancedIndex(const Index& index, uint32_t node, int& height);
+    // the same checks for a PersistentSatNet, plus the BST order and the subtree counts
+    bool checkPersistentAVL(const PersistentLink& node, int min, int max, int& height);
+    // true if the version holds exactly the satellites of satNet, with the same states
+    bool sameFleet(const PersistentSatNet& version, const SatNet& satNet);
+    // true if both trees hold the same IDs with the same altitudes, and the second is a valid AVL tree
+    bool sameTree(const SatNet& expected, const SatNet& satNet);
+    // true if every index set of satNet holds exactly the IDs a walk of its tree finds
+    bool indexMatchesTree(const SatNet& satNet);
+    // true if both hold the same satellites with the same attributes, and the second is a valid AVL tree
+    bool sameSatellites(const SatNet& expected, const SatNet& satNet);
+    // true if a JournaledSatNet refuses to open over the snapshot and the journal still holds log
+    bool journalRefused(const std::string& snapshot, const std::string& journal, const std::vector<char>& log);
 };
 int main(){
     Tester tester;
@@ -344,6 +428,247 @@ int main(){
         else
             std::cout << "Test 17 failed: insertion operation does not perform in O(log n) (n = " << numberOfSatellites << ")" << std::endl;
     }
+    {
+        // TEST 18: Test that clear() releases the whole pool and the tree can be rebuilt from it.
+        // create a satnet instance
+        SatNet satNet;
+        int numberOfSatellites = 300;
+        // call the test function
+        if (tester.testClearAndReuse(satNet, numberOfSatellites))
+            std::cout << "Test 18 passed: clear() and rebuild (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 18 failed: clear() and rebuild (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 19: Test the subtree counts after insertions, state changes and removals, over whole tree and ID ranges.
+        // create a satnet instance
+        SatNet satNet;
+        int numberOfSatellites = 500;
+        // call the test function
+        if (tester.testCountSatellitesInRange(satNet, numberOfSatellites))
+            std::cout << "Test 19 passed: countSatellites(...) over ID ranges (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 19 failed: countSatellites(...) over ID ranges (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 20: Test that the direct-indexed SatTable answers exactly like SatNet for the same operations.
+        // create a satnet and a sattable instance
+        SatNet satNet;
+        SatTable satTable;
+        int numberOfSatellites = 2000;
+        // call the test function
+        if (tester.testTableMatchesTree(satNet, satTable, numberOfSatellites))
+            std::cout << "Test 20 passed: SatTable matches SatNet (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 20 failed: SatTable does not match SatNet (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 21: Test bulkLoad(...) and bulkMerge(...) with duplicates and out-of-range IDs in the batch.
+        // create a satnet instance
+        SatNet satNet;
+        int numberOfSatellites = 1000;
+        // call the test function
+        if (tester.testBulkLoad(satNet, numberOfSatellites))
+            std::cout << "Test 21 passed: bulkLoad(...) and bulkMerge(...) (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 21 failed: bulkLoad(...) and bulkMerge(...) (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 22: Test the outcomes reported by tryInsert(...) and tryRemove(...).
+        // create a satnet instance
+        SatNet satNet;
+        int numberOfSatellites = 300;
+        // call the test function
+        if (tester.testTryInsertRemove(satNet, numberOfSatellites))
+            std::cout << "Test 22 passed: tryInsert(...) and tryRemove(...) outcomes (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 22 failed: tryInsert(...) and tryRemove(...) outcomes (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 23: Test removeIf(...) and the count returned by removeDeorbited().
+        // create a satnet instance
+        SatNet satNet;
+        int numberOfSatellites = 1000;
+        // call the test function
+        if (tester.testRemoveIf(satNet, numberOfSatellites))
+            std::cout << "Test 23 passed: removeIf(...) and removeDeorbited() count (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 23 failed: removeIf(...) and removeDeorbited() count (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 24: Test that freezeSnapshot() answers like the tree and does not change with it.
+        // create a satnet instance
+        SatNet satNet;
+        int numberOfSatellites = 3000;
+        // call the test function
+        if (tester.testFreezeSnapshot(satNet, numberOfSatellites))
+            std::cout << "Test 24 passed: freezeSnapshot() lookups and counts (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 24 failed: freezeSnapshot() lookups and counts (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 25: Test that findSatellites(...) and setStates(...) match the one-at-a-time calls.
+        // create a satnet instance
+        SatNet satNet;
+        int numberOfSatellites = 2000;
+        // call the test function
+        if (tester.testBatchedLookup(satNet, numberOfSatellites))
+            std::cout << "Test 25 passed: findSatellites(...) and setStates(...) batches (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 25 failed: findSatellites(...) and setStates(...) batches (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 26: Test ConcurrentSatNet readers against writers churning the tree.
+        // create a concurrent satnet instance
+        ConcurrentSatNet fleet;
+        int numberOfSatellites = 2000;
+        // call the test function
+        if (tester.testConcurrentSatNet(fleet, numberOfSatellites))
+            std::cout << "Test 26 passed: ConcurrentSatNet readers and writers (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 26 failed: ConcurrentSatNet readers and writers (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 27: Test lock-free setState/getState against each other and against structural writers.
+        // create a concurrent satnet instance
+        ConcurrentSatNet fleet;
+        int numberOfSatellites = 5000;
+        // call the test function
+        if (tester.testLockFreeStates(fleet, numberOfSatellites))
+            std::cout << "Test 27 passed: lock-free setState(...) and getState(...) (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 27 failed: lock-free setState(...) and getState(...) (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 28: Test that PersistentSatNet versions are independent, balanced and share their nodes.
+        int numberOfSatellites = 2000;
+        // call the test function
+        if (tester.testPersistentSatNet(numberOfSatellites))
+            std::cout << "Test 28 passed: PersistentSatNet versions (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 28 failed: PersistentSatNet versions (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 29: Test the copy constructor, move constructor, move assignment and swap.
+        // create a satnet instance
+        SatNet satNet;
+        int numberOfSatellites = 500;
+        // call the test function
+        if (tester.testMoveAndSwap(satNet, numberOfSatellites))
+            std::cout << "Test 29 passed: copy, move and swap (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 29 failed: copy, move and swap (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 30: Test that bulk loads, merges and copies split across SatWorkers match the serial ones.
+        int numberOfSatellites = 30000;
+        // call the test function
+        if (tester.testParallelBuild(numberOfSatellites))
+            std::cout << "Test 30 passed: parallel bulkLoad, bulkMerge and copyFrom (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 30 failed: parallel bulkLoad, bulkMerge and copyFrom (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 31: Test SatQuery histograms, counts and ID lists against a plain walk of the fleet.
+        SatNet satNet;
+        int numberOfSatellites = 20000;
+        // call the test function
+        if (tester.testParallelQuery(satNet, numberOfSatellites))
+            std::cout << "Test 31 passed: parallel histogram, count and findIDs (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 31 failed: parallel histogram, count and findIDs (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 32: Test that the attribute index follows every kind of change to the tree.
+        SatNet satNet;
+        int numberOfSatellites = 3000;
+        // call the test function
+        if (tester.testAttributeIndex(satNet, numberOfSatellites))
+            std::cout << "Test 32 passed: attribute index and getIDs(...) filters (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 32 failed: attribute index and getIDs(...) filters (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 33: Test in-order iterators, lower_bound/upper_bound/equal_range and forEachInRange(...).
+        SatNet satNet;
+        int numberOfSatellites = 2000;
+        // call the test function
+        if (tester.testIterators(satNet, numberOfSatellites))
+            std::cout << "Test 33 passed: iterators and range queries (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 33 failed: iterators and range queries (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 34: Test buffered listSatellites(...) and dumpTree(...) in every format and to every kind of sink.
+        SatNet satNet;
+        int numberOfSatellites = 3000;
+        // call the test function
+        if (tester.testListingOutput(satNet, numberOfSatellites))
+            std::cout << "Test 34 passed: buffered listing in TEXT, CSV and JSONL (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 34 failed: buffered listing in TEXT, CSV and JSONL (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 35: Test saveSnapshot/loadSnapshot round trips, in-place SatImage lookups and damaged files.
+        SatNet satNet;
+        int numberOfSatellites = 5000;
+        // call the test function
+        if (tester.testSnapshotFile(satNet, numberOfSatellites))
+            std::cout << "Test 35 passed: binary snapshot save and load (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 35 failed: binary snapshot save and load (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 36: Test JournaledSatNet recovery: replay, checkpoints, torn groups, stale logs and group commit.
+        int numberOfSatellites = 4000;
+        // call the test function
+        if (tester.testJournal(numberOfSatellites))
+            std::cout << "Test 36 passed: write-ahead journal and replay (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 36 failed: write-ahead journal and replay (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 37: Test SatIngest: CSV round trips, column headers, bad lines, duplicates and chunk boundaries.
+        SatNet satNet;
+        int numberOfSatellites = 5000;
+        // call the test function
+        if (tester.testIngest(satNet, numberOfSatellites))
+            std::cout << "Test 37 passed: streaming catalog ingest (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 37 failed: streaming catalog ingest (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 38: Test SatNet::stats(): rotations, descents, pool traffic, retraces, latencies and reset.
+        SatNet satNet;
+        int numberOfSatellites = 4096;
+        // call the test function
+        if (tester.testStats(satNet, numberOfSatellites))
+            std::cout << "Test 38 passed: instrumentation counters, " << (SatNetStats::ENABLED ? "enabled" : "disabled")
+                      << " (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 38 failed: instrumentation counters, " << (SatNetStats::ENABLED ? "enabled" : "disabled")
+                      << " (n = " << numberOfSatellites << ")" << std::endl;
+    }
+    {
+        // TEST 39: Test BalancedIndex with 16-bit and 32-bit keys, a struct payload and a reversed order against std::map.
+        int numberOfOperations = 20000;
+        // call the test function
+        if (tester.testBalancedIndex(numberOfOperations))
+            std::cout << "Test 39 passed: BalancedIndex template instantiations (n = " << numberOfOperations << ")" << std::endl;
+        else
+            std::cout << "Test 39 failed: BalancedIndex template instantiations (n = " << numberOfOperations << ")" << std::endl;
+    }
+    {
+        // TEST 40: Test every ConcurrentSatNet read against structural writers; run it under ThreadSanitizer.
+        // create a concurrent satnet instance
+        ConcurrentSatNet fleet;
+        int numberOfSatellites = 3000;
+        // call the test function
+        if (tester.testConcurrentReadWrite(fleet, numberOfSatellites))
+            std::cout << "Test 40 passed: ConcurrentSatNet reads during writes (n = " << numberOfSatellites << ")" << std::endl;
+        else
+            std::cout << "Test 40 failed: ConcurrentSatNet reads during writes (n = " << numberOfSatellites << ")" << std::endl;
+    }
 }
 
 // Test Helpers
@@ -394,11 +719,10 @@ std::vector<int> Tester::removeNSatellites(SatNet& satNet, int n) {
 
 // measure time for different operations
 double Tester::measureTime(SatNet &satNet, Tester::MEASURE_TIME_OPERATION operation, int n) {
-    // start time
-    double T = 0.0;
-    clock_t start, stop;
-    start = clock();
-    
+    // start time; steady_clock is monotonic and fine-grained, where clock()
+    // often ticks too coarsely to time a few thousand operations
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
     // perform operation switch-case
     switch (operation) {
         case INSERT:
@@ -414,12 +738,74 @@ double Tester::measureTime(SatNet &satNet, Tester::MEASURE_TIME_OPERATION operat
     }
 
     // stop time
-    stop = clock();
-    T = stop - start;
-    double measureTime = T / CLOCKS_PER_SEC;
-    return measureTime;
+    std::chrono::duration<double> measureTime = std::chrono::steady_clock::now() - start;
+    return measureTime.count();
+}
+
+// check every node: stored height is right and balance is within [-1, 1]
+bool Tester::checkAVL(const SatNet& satNet, SatIndex node, int& height) {
+    if (node == NOSAT) {
+        height = 0;
+        return true;
+    }
+    int leftHeight = 0;
+    int rightHeight = 0;
+    if (!checkAVL(satNet, satNet.m_pool[node].m_left, leftHeight) || !checkAVL(satNet, satNet.m_pool[node].m_right, rightHeight)) {
+        return false;
+    }
+    height = 1 + std::max(leftHeight, rightHeight);
+    return (int)satNet.m_pool[node].m_height == height && std::abs(leftHeight - rightHeight) <= 1;
+}
+
+bool Tester::checkPersistentAVL(const PersistentLink& node, int min, int max, int& height) {
+    if (!node) {
+        height = 0;
+        return true;
+    }
+    int leftHeight = 0;
+    int rightHeight = 0;
+    if (node->m_id < min || node->m_id > max ||
+        !checkPersistentAVL(node->m_left, min, node->m_id - 1, leftHeight) ||
+        !checkPersistentAVL(node->m_right, node->m_id + 1, max, rightHeight)) {
+        return false;
+    }
+    height = 1 + std::max(leftHeight, rightHeight);
+    int total = 1 + (node->m_left ? node->m_left->m_counts.total() : 0) + (node->m_right ? node->m_right->m_counts.total() : 0);
+    return node->m_height == height && std::abs(leftHeight - rightHeight) <= 1 && node->m_counts.total() == total;
+}
+
+bool Tester::sameFleet(const PersistentSatNet& version, const SatNet& satNet) {
+    SatNet copy = version.toSatNet();
+    for (int id = MINID; id <= MAXID; id++) {
+        STATE state = ACTIVE;
+        bool found = version.getState(id, state);
+        if (found != satNet.findSatellite(id) || copy.findSatellite(id) != found) {
+            return false;
+        }
+    }
+    for (int k = 0; k < NUMSTATES; k++) {
+        if (version.countSatellites((STATE)k) != satNet.countSatellites((STATE)k) ||
+            version.getCounts(30000, 60000).m_state[k] != satNet.countSatellites((STATE)k, 30000, 60000) ||
+            copy.countSatellites((STATE)k) != satNet.countSatellites((STATE)k)) {
+            return false;
+        }
+    }
+    return version.size() == satNet.getCounts().total();
 }
 
+bool Tester::sameTree(const SatNet& expected, const SatNet& satNet) {
+    int height = 0;
+    if (!checkAVL(satNet, satNet.getRoot(), height) || !satNet.getBSTValidity(satNet.getRoot())) {
+        return false;
+    }
+    for (int id = MINID; id <= MAXID; id++) {
+        if (expected.findSatellite(id) != satNet.findSatellite(id) ||
+            expected.countSatellites(MI340, id, id) != satNet.countSatellites(MI340, id, id)) {
+            return false;
+        }
+    }
+    return true;
+}
 
 // Test 1: Test the insertion function for a normal case.
 bool Tester::testInsertNormal(SatNet& satNet, int n) {
@@ -935,3 +1321,2135 @@ bool Tester::testInsertTimeComplexity(SatNet &satNet, int n) {
     }
 }
 
+// TEST 18: Test that clear() releases the whole pool and the tree can be rebuilt from it.
+bool Tester::testClearAndReuse(SatNet &satNet, int n) {
+    try {
+        std::vector<int> insertedIDs = Tester::insertNSatellites(satNet, n);
+        satNet.clear();
+
+        // nothing may survive a clear
+        if (satNet.getRoot() != NOSAT || satNet.m_pool.size() != 0) {
+            std::cerr << "Error (Test 18): tree not empty after clear()" << std::endl;
+            return false;
+        }
+        for (int i = 0; i < n; i++) {
+            if (satNet.findSatellite(insertedIDs[i])) {
+                std::cerr << "Error (Test 18): Satellite found after clear() (ID: " << insertedIDs[i] << ")" << std::endl;
+                return false;
+            }
+        }
+
+        // the same IDs go back in, recycling the released nodes
+        insertedIDs = Tester::insertNSatellites(satNet, n);
+        for (int i = 0; i < n; i++) {
+            if (!satNet.findSatellite(insertedIDs[i])) {
+                std::cerr << "Error (Test 18): Satellite not found after rebuild (ID: " << insertedIDs[i] << ")" << std::endl;
+                return false;
+            }
+        }
+        return satNet.m_pool.size() == n && satNet.getBSTValidity(satNet.getRoot());
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 18): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 19: Test the subtree counts after insertions, state changes and removals, over whole tree and ID ranges.
+bool Tester::testCountSatellitesInRange(SatNet &satNet, int n) {
+    try {
+        // satellites in the tree, kept alongside it to count by brute force
+        std::vector<Sat> fleet;
+        Random idGen(MINID, MAXID);
+        for (int i = 0; i < n; i++) {
+            int id = idGen.getRandNum();
+            if (satNet.findSatellite(id)) {
+                continue;
+            }
+            Sat satellite(id, (ALT)(i % NUMALTS), (INCLIN)((i / 2) % NUMINCLINS), (STATE)(i % NUMSTATES));
+            satNet.insert(satellite);
+            fleet.push_back(satellite);
+        }
+
+        // change some states and remove some satellites, both must update the counts
+        for (size_t i = 0; i < fleet.size(); i += 7) {
+            satNet.setState(fleet[i].getID(), DECAYING);
+            fleet[i].setState(DECAYING);
+        }
+        for (size_t i = 0; i < fleet.size(); i += 5) {
+            satNet.remove(fleet[i].getID());
+            fleet.erase(fleet.begin() + i);
+        }
+
+        int ranges[][2] = {{MINID, MAXID}, {40000, 45000}, {10000, 10000}, {70000, 20000}, {55555, 99999}};
+        for (int r = 0; r < 5; r++) {
+            int lo = ranges[r][0];
+            int hi = ranges[r][1];
+            SatCounts expected;
+            for (size_t i = 0; i < fleet.size(); i++) {
+                if (fleet[i].getID() >= lo && fleet[i].getID() <= hi) {
+                    expected.add(fleet[i].getState(), fleet[i].getAlt(), fleet[i].getInclin());
+                }
+            }
+            for (int k = 0; k < NUMINCLINS; k++) {
+                if (satNet.countSatellites((INCLIN)k, lo, hi) != expected.m_inclin[k]) {
+                    std::cerr << "Error (Test 19): inclination count mismatch in [" << lo << ", " << hi << "]" << std::endl;
+                    return false;
+                }
+            }
+            for (int k = 0; k < NUMALTS; k++) {
+                if (satNet.countSatellites((ALT)k, lo, hi) != expected.m_alt[k]) {
+                    std::cerr << "Error (Test 19): altitude count mismatch in [" << lo << ", " << hi << "]" << std::endl;
+                    return false;
+                }
+            }
+            for (int k = 0; k < NUMSTATES; k++) {
+                if (satNet.countSatellites((STATE)k, lo, hi) != expected.m_state[k]) {
+                    std::cerr << "Error (Test 19): state count mismatch in [" << lo << ", " << hi << "]" << std::endl;
+                    return false;
+                }
+            }
+        }
+
+        // whole-tree counts come straight from the root
+        int total = 0;
+        for (int k = 0; k < NUMINCLINS; k++) {
+            total += satNet.countSatellites((INCLIN)k);
+        }
+        return total == (int)fleet.size();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 19): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 20: Test that the direct-indexed SatTable answers exactly like SatNet for the same operations.
+bool Tester::testTableMatchesTree(SatNet &satNet, SatTable &satTable, int n) {
+    try {
+        Random idGen(MINID, MAXID);
+        std::vector<int> ids;
+        for (int i = 0; i < n; i++) {
+            int id = idGen.getRandNum();
+            if (satNet.findSatellite(id)) {
+                // both backends must reject the duplicate
+                bool tableThrew = false;
+                try {
+                    satTable.insert(Sat(id));
+                }
+                catch (const std::exception& e) {
+                    tableThrew = true;
+                }
+                if (!tableThrew) {
+                    std::cerr << "Error (Test 20): SatTable accepted a duplicate (ID: " << id << ")" << std::endl;
+                    return false;
+                }
+                continue;
+            }
+            Sat satellite(id, (ALT)(i % NUMALTS), (INCLIN)(id % NUMINCLINS), (STATE)(i % NUMSTATES));
+            satNet.insert(satellite);
+            satTable.insert(satellite);
+            ids.push_back(id);
+        }
+        for (size_t i = 0; i < ids.size(); i += 3) {
+            satNet.setState(ids[i], DEORBITED);
+            satTable.setState(ids[i], DEORBITED);
+        }
+        for (size_t i = 1; i < ids.size(); i += 4) {
+            satNet.remove(ids[i]);
+            satTable.remove(ids[i]);
+        }
+        satNet.removeDeorbited();
+        satTable.removeDeorbited();
+
+        for (size_t i = 0; i < ids.size(); i++) {
+            if (satNet.findSatellite(ids[i]) != satTable.findSatellite(ids[i])) {
+                std::cerr << "Error (Test 20): findSatellite mismatch (ID: " << ids[i] << ")" << std::endl;
+                return false;
+            }
+        }
+        for (int k = 0; k < NUMINCLINS; k++) {
+            if (satNet.countSatellites((INCLIN)k) != satTable.countSatellites((INCLIN)k) ||
+                satNet.countSatellites((INCLIN)k, 30000, 60000) != satTable.countSatellites((INCLIN)k, 30000, 60000)) {
+                std::cerr << "Error (Test 20): countSatellites mismatch" << std::endl;
+                return false;
+            }
+        }
+        return satTable.countSatellites(DEORBITED) == 0 && !satTable.findSatellite(MINID - 1);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 20): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 21: Test bulkLoad(...) and bulkMerge(...) with duplicates and out-of-range IDs in the batch.
+bool Tester::testBulkLoad(SatNet &satNet, int n) {
+    try {
+        // even IDs, each twice, plus two out-of-range IDs
+        std::vector<Sat> batch;
+        for (int i = 0; i < n; i++) {
+            batch.push_back(Sat(MINID + 2 * i, MI340));
+            batch.push_back(Sat(MINID + 2 * i, MI208));
+        }
+        batch.push_back(Sat(MINID - 1));
+        batch.push_back(Sat(MAXID + 1));
+        std::shuffle(batch.begin(), batch.end(), std::mt19937(10));
+
+        SatLoadReport report = satNet.bulkLoad(batch);
+        int height = 0;
+        if (report.m_loaded != n || (int)report.m_duplicates.size() != n || report.m_outOfRange.size() != 2 ||
+            !checkAVL(satNet, satNet.getRoot(), height) || !satNet.getBSTValidity(satNet.getRoot())) {
+            std::cerr << "Error (Test 21): bulkLoad(...) report or tree shape is wrong" << std::endl;
+            return false;
+        }
+
+        // merge odd IDs and half of the even ones again, the tree's copies must win
+        batch.clear();
+        for (int i = 0; i < n; i++) {
+            batch.push_back(Sat(MINID + 2 * i + 1, MI350));
+            if (i % 2 == 0) {
+                batch.push_back(Sat(MINID + 2 * i, MI350));
+            }
+        }
+        report = satNet.bulkMerge(batch);
+        if (report.m_loaded != n || (int)report.m_duplicates.size() != (n + 1) / 2 ||
+            !checkAVL(satNet, satNet.getRoot(), height) || !satNet.getBSTValidity(satNet.getRoot())) {
+            std::cerr << "Error (Test 21): bulkMerge(...) report or tree shape is wrong" << std::endl;
+            return false;
+        }
+        // the first copy of each even ID was kept by bulkLoad, whichever it was, and never replaced by MI350
+        for (int i = 0; i < 2 * n; i++) {
+            if (!satNet.findSatellite(MINID + i)) {
+                std::cerr << "Error (Test 21): Satellite not found (ID: " << MINID + i << ")" << std::endl;
+                return false;
+            }
+        }
+        return satNet.countSatellites(MI350) == n && satNet.countSatellites(I48) == 2 * n;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 21): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 22: Test the outcomes reported by tryInsert(...) and tryRemove(...).
+bool Tester::testTryInsertRemove(SatNet &satNet, int n) {
+    try {
+        for (int i = 0; i < n; i++) {
+            if (satNet.tryInsert(Sat(MINID + 3 * i, MI215)) != SUCCESS) {
+                std::cerr << "Error (Test 22): tryInsert(...) rejected a new satellite" << std::endl;
+                return false;
+            }
+        }
+        // duplicates and bad IDs leave the tree as it was
+        for (int i = 0; i < n; i++) {
+            if (satNet.tryInsert(Sat(MINID + 3 * i, MI350)) != DUPLICATE) {
+                std::cerr << "Error (Test 22): tryInsert(...) accepted a duplicate" << std::endl;
+                return false;
+            }
+        }
+        if (satNet.tryInsert(Sat(MINID - 1)) != OUT_OF_RANGE || satNet.tryInsert(Sat(MAXID + 1)) != OUT_OF_RANGE ||
+            satNet.countSatellites(MI350) != 0 || satNet.countSatellites(MI215) != n) {
+            std::cerr << "Error (Test 22): tryInsert(...) changed the tree on a rejected insert" << std::endl;
+            return false;
+        }
+
+        // every other satellite goes, then again to hit NOT_FOUND
+        for (int i = 0; i < n; i += 2) {
+            if (satNet.tryRemove(MINID + 3 * i) != SUCCESS || satNet.tryRemove(MINID + 3 * i) != NOT_FOUND ||
+                satNet.tryRemove(MINID + 3 * i + 1) != NOT_FOUND) {
+                std::cerr << "Error (Test 22): tryRemove(...) outcome is wrong (ID: " << MINID + 3 * i << ")" << std::endl;
+                return false;
+            }
+        }
+        int height = 0;
+        return satNet.tryRemove(MAXID + 1) == OUT_OF_RANGE && satNet.countSatellites(MI215) == n / 2 &&
+               checkAVL(satNet, satNet.getRoot(), height) && satNet.getBSTValidity(satNet.getRoot());
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 22): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 23: Test removeIf(...) and the count returned by removeDeorbited().
+bool Tester::testRemoveIf(SatNet &satNet, int n) {
+    try {
+        for (int i = 0; i < n; i++) {
+            satNet.insert(Sat(MINID + i, (ALT)(i % NUMALTS), I53, (STATE)(i % NUMSTATES)));
+        }
+
+        // DECAYING at MI208: i % 3 == 2 and i % 4 == 0
+        int expected = 0;
+        for (int i = 0; i < n; i++) {
+            expected += (i % NUMSTATES == DECAYING && i % NUMALTS == MI208);
+        }
+        int removed = satNet.removeIf([](const Sat& satellite) {
+            return satellite.getState() == DECAYING && satellite.getAlt() == MI208;
+        });
+        int height = 0;
+        if (removed != expected || satNet.m_pool.size() != n - removed || !checkAVL(satNet, satNet.getRoot(), height) ||
+            !satNet.getBSTValidity(satNet.getRoot())) {
+            std::cerr << "Error (Test 23): removeIf(...) removed " << removed << ", expected " << expected << std::endl;
+            return false;
+        }
+        for (int i = 0; i < n; i++) {
+            bool gone = (i % NUMSTATES == DECAYING && i % NUMALTS == MI208);
+            if (satNet.findSatellite(MINID + i) == gone) {
+                std::cerr << "Error (Test 23): wrong satellite removed or kept (ID: " << MINID + i << ")" << std::endl;
+                return false;
+            }
+        }
+
+        // nothing matches: the tree is left alone
+        if (satNet.removeIf([](const Sat& satellite) { return satellite.getInclin() == I97; }) != 0) {
+            std::cerr << "Error (Test 23): removeIf(...) removed satellites that do not match" << std::endl;
+            return false;
+        }
+
+        int deorbited = satNet.countSatellites(DEORBITED);
+        return deorbited > 0 && satNet.removeDeorbited() == deorbited && satNet.countSatellites(DEORBITED) == 0 &&
+               checkAVL(satNet, satNet.getRoot(), height);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 23): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 24: Test that freezeSnapshot() answers like the tree and does not change with it.
+bool Tester::testFreezeSnapshot(SatNet &satNet, int n) {
+    try {
+        // an empty snapshot answers no to everything
+        SatSnapshot empty = satNet.freezeSnapshot();
+        if (empty.findSatellite(MINID) || empty.countSatellites(I48, MINID, MAXID) != 0) {
+            std::cerr << "Error (Test 24): empty snapshot is not empty" << std::endl;
+            return false;
+        }
+
+        Random idGen(MINID, MAXID);
+        for (int i = 0; i < n; i++) {
+            satNet.tryInsert(Sat(idGen.getRandNum(), (ALT)(i % NUMALTS), (INCLIN)((i / 3) % NUMINCLINS), (STATE)(i % NUMSTATES)));
+        }
+        SatSnapshot snapshot = satNet.freezeSnapshot();
+
+        // every ID in range, hits and misses, including both ends
+        for (int id = MINID - 1; id <= MAXID + 1; id++) {
+            STATE state = ACTIVE;
+            bool inTree = satNet.findSatellite(id);
+            if (snapshot.findSatellite(id) != inTree || snapshot.getState(id, state) != inTree) {
+                std::cerr << "Error (Test 24): snapshot lookup mismatch (ID: " << id << ")" << std::endl;
+                return false;
+            }
+        }
+        int ranges[][2] = {{MINID, MAXID}, {40000, 45000}, {MINID - 5, MINID}, {MAXID, MAXID + 5}, {60000, 50000}};
+        for (int r = 0; r < 5; r++) {
+            for (int k = 0; k < NUMINCLINS; k++) {
+                if (snapshot.countSatellites((INCLIN)k, ranges[r][0], ranges[r][1]) !=
+                    satNet.countSatellites((INCLIN)k, ranges[r][0], ranges[r][1])) {
+                    std::cerr << "Error (Test 24): snapshot count mismatch in [" << ranges[r][0] << ", " << ranges[r][1] << "]" << std::endl;
+                    return false;
+                }
+            }
+        }
+
+        // the snapshot keeps answering for the fleet as it was frozen
+        int size = snapshot.size();
+        int deorbited = snapshot.countSatellites(DEORBITED);
+        satNet.removeDeorbited();
+        return snapshot.size() == size && snapshot.countSatellites(DEORBITED) == deorbited && deorbited > 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 24): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 25: Test that findSatellites(...) and setStates(...) match the one-at-a-time calls.
+bool Tester::testBatchedLookup(SatNet &satNet, int n) {
+    try {
+        // a batch against an empty tree finds nothing
+        int none[] = {MINID, MAXID};
+        bool noneFound[] = {true, true};
+        satNet.findSatellites(none, 2, noneFound);
+        if (noneFound[0] || noneFound[1]) {
+            std::cerr << "Error (Test 25): found a satellite in an empty tree" << std::endl;
+            return false;
+        }
+
+        std::vector<int> ids = insertNSatellites(satNet, n);
+
+        // hits, misses, repeats and IDs outside the range, in a batch that is
+        // neither a multiple of the lane count nor smaller than it
+        Random queryGen(MINID - 10, MAXID + 10);
+        int batch = 3 * n + 7;
+        std::vector<int> queries;
+        for (int i = 0; i < batch; i++) {
+            queries.push_back((i % 2 == 0) ? ids[i % ids.size()] : queryGen.getRandNum());
+        }
+        bool* found = new bool[batch];
+        satNet.findSatellites(queries.data(), batch, found);
+        for (int i = 0; i < batch; i++) {
+            if (found[i] != satNet.findSatellite(queries[i])) {
+                std::cerr << "Error (Test 25): findSatellites mismatch (ID: " << queries[i] << ")" << std::endl;
+                delete[] found;
+                return false;
+            }
+        }
+
+        // the same updates applied one at a time to a copy; a repeated ID
+        // takes the last state given for it
+        SatNet expected(satNet);
+        std::vector<STATE> states;
+        for (int i = 0; i < batch; i++) {
+            states.push_back((STATE)(i % NUMSTATES));
+            expected.setState(queries[i], states[i]);
+        }
+        satNet.setStates(queries.data(), states.data(), batch, found);
+        for (int i = 0; i < batch; i++) {
+            if (found[i] != satNet.findSatellite(queries[i])) {
+                std::cerr << "Error (Test 25): setStates reported a wrong outcome (ID: " << queries[i] << ")" << std::endl;
+                delete[] found;
+                return false;
+            }
+        }
+        delete[] found;
+
+        for (int k = 0; k < NUMSTATES; k++) {
+            if (satNet.countSatellites((STATE)k) != expected.countSatellites((STATE)k) ||
+                satNet.countSatellites((STATE)k, 30000, 60000) != expected.countSatellites((STATE)k, 30000, 60000)) {
+                std::cerr << "Error (Test 25): state counts differ after setStates" << std::endl;
+                return false;
+            }
+        }
+        return satNet.getCounts().total() == expected.getCounts().total();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 25): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 26: Test ConcurrentSatNet readers against writers churning the tree.
+// n stable satellites at even IDs stay in the fleet the whole time, while two
+// writers insert and remove odd IDs around them and flip the stable ones
+// between ACTIVE and DECAYING. Readers must always find the stable IDs, never
+// find IDs that nobody inserts, and never see a stable satellite DEORBITED.
+bool Tester::testConcurrentSatNet(ConcurrentSatNet &fleet, int n) {
+    try {
+        const int base = 20000;
+        for (int i = 0; i < n; i++) {
+            fleet.insert(Sat(base + 2 * i));
+        }
+
+        std::atomic<int> errors(0);
+        std::atomic<bool> writing(true);
+        std::vector<std::thread> writers;
+        for (int w = 0; w < 2; w++) {
+            writers.push_back(std::thread([&fleet, &errors, n, w]() {
+                for (int round = 0; round < 5; round++) {
+                    for (int i = w; i < n; i += 2) {
+                        if (fleet.tryInsert(Sat(base + 2 * i + 1)) != SUCCESS) {
+                            errors++;
+                        }
+                        fleet.setState(base + 2 * i, (round % 2 == 1) ? DECAYING : ACTIVE);
+                    }
+                    for (int i = w; i < n; i += 2) {
+                        if (fleet.tryRemove(base + 2 * i + 1) != SUCCESS) {
+                            errors++;
+                        }
+                    }
+                }
+            }));
+        }
+
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 2; r++) {
+            readers.push_back(std::thread([&fleet, &errors, &writing, n]() {
+                // keep reading until the writers are done, at least once through
+                do {
+                    for (int i = 0; i < n; i++) {
+                        STATE state = DEORBITED;
+                        if (!fleet.getState(base + 2 * i, state) || state == DEORBITED ||
+                            !fleet.findSatellite(base + 2 * i) ||
+                            fleet.findSatellite(base + 2 * n + 2 * i + 1)) {
+                            errors++;
+                        }
+                    }
+                } while (writing);
+            }));
+        }
+
+        for (size_t i = 0; i < writers.size(); i++) {
+            writers[i].join();
+        }
+        writing = false;
+        for (size_t i = 0; i < readers.size(); i++) {
+            readers[i].join();
+        }
+        if (errors != 0) {
+            std::cerr << "Error (Test 26): " << errors << " inconsistent operations" << std::endl;
+            return false;
+        }
+
+        // only the stable satellites are left, in a valid AVL tree, and the
+        // last round put every one of them back to ACTIVE
+        SatNet copy = fleet.copy();
+        int height = 0;
+        return copy.getBSTValidity(copy.getRoot()) && checkAVL(copy, copy.getRoot(), height) &&
+               fleet.getCounts().total() == n && fleet.countSatellites(DECAYING) == 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 26): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 27: Test lock-free setState/getState against each other and against structural writers.
+// Two writers walk n satellites from ACTIVE to DECAYING and then to DEORBITED,
+// a third inserts and removes other IDs under the lock. Readers must always
+// get a valid state for every satellite and never see one move backwards.
+// Afterwards the totals, the range counts and a copy of the tree must agree.
+bool Tester::testLockFreeStates(ConcurrentSatNet &fleet, int n) {
+    try {
+        const int base = 20000;
+        for (int i = 0; i < n; i++) {
+            fleet.insert(Sat(base + i));
+        }
+
+        std::atomic<int> errors(0);
+        std::atomic<bool> writing(true);
+        std::vector<std::thread> writers;
+        for (int w = 0; w < 2; w++) {
+            writers.push_back(std::thread([&fleet, &errors, n, w]() {
+                STATE steps[] = {DECAYING, DEORBITED};
+                for (int s = 0; s < 2; s++) {
+                    for (int i = w; i < n; i += 2) {
+                        if (!fleet.setState(base + i, steps[s])) {
+                            errors++;
+                        }
+                    }
+                }
+            }));
+        }
+        writers.push_back(std::thread([&fleet, &errors, n]() {
+            for (int round = 0; round < 3; round++) {
+                for (int i = 0; i < n; i++) {
+                    if (fleet.tryInsert(Sat(base + n + i, MI208, I48, DECAYING)) != SUCCESS) {
+                        errors++;
+                    }
+                }
+                for (int i = 0; i < n; i++) {
+                    if (fleet.tryRemove(base + n + i) != SUCCESS) {
+                        errors++;
+                    }
+                }
+            }
+        }));
+
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 2; r++) {
+            readers.push_back(std::thread([&fleet, &errors, &writing, n]() {
+                // progress of each state along ACTIVE, DECAYING, DEORBITED
+                int rank[NUMSTATES];
+                rank[ACTIVE] = 0;
+                rank[DECAYING] = 1;
+                rank[DEORBITED] = 2;
+                std::vector<int> seen(n, 0);
+                do {
+                    for (int i = 0; i < n; i++) {
+                        STATE state = ACTIVE;
+                        if (!fleet.getState(base + i, state) || state < ACTIVE || state > DECAYING ||
+                            rank[state] < seen[i]) {
+                            errors++;
+                            continue;
+                        }
+                        seen[i] = rank[state];
+                    }
+                } while (writing);
+            }));
+        }
+
+        for (size_t i = 0; i < writers.size(); i++) {
+            writers[i].join();
+        }
+        writing = false;
+        for (size_t i = 0; i < readers.size(); i++) {
+            readers[i].join();
+        }
+        if (errors != 0) {
+            std::cerr << "Error (Test 27): " << errors << " inconsistent operations" << std::endl;
+            return false;
+        }
+
+        SatCounts counts = fleet.getCounts();
+        SatNet copy = fleet.copy();
+        for (int k = 0; k < NUMSTATES; k++) {
+            int expected = (k == DEORBITED) ? n : 0;
+            if (fleet.countSatellites((STATE)k) != expected || counts.m_state[k] != expected ||
+                copy.countSatellites((STATE)k) != expected) {
+                std::cerr << "Error (Test 27): state counts disagree after the updates" << std::endl;
+                return false;
+            }
+        }
+        // range counts come from the tree's stale states plus the corrections,
+        // so they must match a copy, whose states come from the side array
+        fleet.setState(base + n / 3, ACTIVE);
+        fleet.setState(base + n / 2, DECAYING);
+        for (int low = base - 10; low < base + n; low += n / 7) {
+            for (int high = low; high < base + n + 10; high += n / 5) {
+                SatCounts expected = fleet.copy().getCounts(low, high);
+                SatCounts got = fleet.getCounts(low, high);
+                for (int k = 0; k < NUMSTATES; k++) {
+                    if (got.m_state[k] != expected.m_state[k]) {
+                        std::cerr << "Error (Test 27): state counts for [" << low << ", " << high << "] are wrong" << std::endl;
+                        return false;
+                    }
+                }
+            }
+        }
+        // removing satellites whose nodes still say ACTIVE must take their
+        // corrections with them
+        fleet.remove(base + n / 3);
+        fleet.remove(base + n / 2);
+        int removed = fleet.removeDeorbited();
+        counts = fleet.getCounts();
+        return removed == n - 2 && counts.m_state[ACTIVE] == 0 && counts.m_state[DEORBITED] == 0 && counts.m_state[DECAYING] == 0 &&
+               fleet.getCounts(base, base + n / 2).total() == 0 &&
+               fleet.countSatellites(DEORBITED) == 0 && !fleet.setState(base, ACTIVE);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 27): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 28: Test that PersistentSatNet versions are independent, balanced and share their nodes.
+// Every change is mirrored in a SatNet, and a deep copy of the mirror is kept
+// next to each snapshot to say what the snapshot must still hold.
+bool Tester::testPersistentSatNet(int n) {
+    long baseline = PersistentNode::live();
+    try {
+        {
+            PersistentSatNet current;
+            SatNet mirror;
+            Random idGen(MINID, MAXID);
+            std::vector<int> ids;
+            for (int i = 0; i < n; i++) {
+                Sat satellite(idGen.getRandNum(), (ALT)(i % NUMALTS), (INCLIN)((i / 2) % NUMINCLINS));
+                if (current.tryInsert(satellite) != mirror.tryInsert(satellite)) {
+                    std::cerr << "Error (Test 28): insert outcome differs (ID: " << satellite.getID() << ")" << std::endl;
+                    return false;
+                }
+                ids.push_back(satellite.getID());
+            }
+
+            PersistentSatNet first = current.snapshot();
+            SatNet firstMirror(mirror);
+
+            // one state change on a fresh snapshot copies only the path
+            long before = PersistentNode::live();
+            current.setState(ids[0], DECAYING);
+            mirror.setState(ids[0], DECAYING);
+            if (PersistentNode::live() - before > current.m_root->m_height) {
+                std::cerr << "Error (Test 28): setState copied more than one path" << std::endl;
+                return false;
+            }
+
+            for (int i = 0; i < n; i++) {
+                if (i % 3 == 0) {
+                    if (current.tryRemove(ids[i]) != mirror.tryRemove(ids[i])) {
+                        std::cerr << "Error (Test 28): remove outcome differs (ID: " << ids[i] << ")" << std::endl;
+                        return false;
+                    }
+                } else if (i % 5 == 0) {
+                    current.setState(ids[i], DEORBITED);
+                    mirror.setState(ids[i], DEORBITED);
+                }
+            }
+            PersistentSatNet second = current.snapshot();
+            SatNet secondMirror(mirror);
+
+            for (int i = 0; i < n; i++) {
+                Sat satellite(idGen.getRandNum());
+                current.tryInsert(satellite);
+                mirror.tryInsert(satellite);
+            }
+            current.clear();
+            mirror.clear();
+            current.insert(Sat(MINID));
+            mirror.insert(Sat(MINID));
+
+            int height = 0;
+            if (!checkPersistentAVL(first.m_root, MINID, MAXID, height) ||
+                !checkPersistentAVL(second.m_root, MINID, MAXID, height)) {
+                std::cerr << "Error (Test 28): a snapshot is not a valid AVL tree" << std::endl;
+                return false;
+            }
+            if (!sameFleet(first, firstMirror) || !sameFleet(second, secondMirror) || !sameFleet(current, mirror)) {
+                std::cerr << "Error (Test 28): a version changed after it was taken" << std::endl;
+                return false;
+            }
+
+            // a version built from a SatNet starts out holding the same fleet
+            if (!sameFleet(PersistentSatNet(secondMirror), secondMirror)) {
+                std::cerr << "Error (Test 28): PersistentSatNet(const SatNet&) lost satellites" << std::endl;
+                return false;
+            }
+        }
+        // the last version to go takes its nodes with it
+        return PersistentNode::live() == baseline;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 28): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 29: Test the copy constructor, move constructor, move assignment and swap.
+// Every fleet that ends up holding satellites must be a valid AVL tree with
+// the right heights, and every fleet left behind by a move must be empty and
+// still usable.
+bool Tester::testMoveAndSwap(SatNet &satNet, int n) {
+    try {
+        std::vector<int> ids = insertNSatellites(satNet, n);
+        int height = 0;
+
+        // the copy keeps the heights and is independent of the original
+        SatNet copy(satNet);
+        copy.remove(ids[0]);
+        if (!checkAVL(copy, copy.getRoot(), height) || !satNet.findSatellite(ids[0]) ||
+            copy.getCounts().total() != n - 1) {
+            std::cerr << "Error (Test 29): copy constructor" << std::endl;
+            return false;
+        }
+
+        SatNet moved(std::move(copy));
+        if (!checkAVL(moved, moved.getRoot(), height) || moved.getCounts().total() != n - 1 ||
+            copy.getRoot() != NOSAT || copy.getCounts().total() != 0) {
+            std::cerr << "Error (Test 29): move constructor" << std::endl;
+            return false;
+        }
+
+        // the moved-from fleet owns no arrays at all, and every call still works on it
+        bool found = true;
+        SatNet empty(copy);
+        empty.findSatellites(&ids[0], 1, &found);
+        if (copy.countSatellites(MI208) != 0 || copy.countSatellites(I48) != 0 ||
+            copy.countSatellites(ACTIVE) != 0 || copy.countSatellites(DECAYING, MINID, MAXID) != 0 ||
+            copy.findSatellite(ids[0]) || found || copy.setState(ids[0], DECAYING) ||
+            copy.tryRemove(ids[0]) != NOT_FOUND || copy.removeDeorbited() != 0 ||
+            !(copy.begin() == copy.end()) || !(copy.lower_bound(MINID) == copy.end()) ||
+            copy.getIDs().size() != 0 || empty.getCounts().total() != 0 ||
+            copy.getBalance(copy.getRoot()) != 0 || SatNet().getBalance(NOSAT) != 0 ||
+            empty.freezeSnapshot().findSatellite(ids[0])) {
+            std::cerr << "Error (Test 29): a moved-from fleet does not behave as empty" << std::endl;
+            return false;
+        }
+        copy.insert(Sat(ids[0]));
+
+        SatNet target;
+        target.insert(Sat(MAXID));
+        target = std::move(moved);
+        if (!checkAVL(target, target.getRoot(), height) || target.getCounts().total() != n - 1 ||
+            target.findSatellite(MAXID) != satNet.findSatellite(MAXID) || moved.getCounts().total() != 0) {
+            std::cerr << "Error (Test 29): move assignment" << std::endl;
+            return false;
+        }
+        moved.insert(Sat(MINID));
+
+        // self-move and self-swap leave the fleet alone
+        SatNet& self = target;
+        target = std::move(self);
+        target.swap(target);
+        if (target.getCounts().total() != n - 1) {
+            std::cerr << "Error (Test 29): self-move or self-swap changed the fleet" << std::endl;
+            return false;
+        }
+
+        swap(copy, target);
+        return copy.getCounts().total() == n - 1 && target.getCounts().total() == 1 &&
+               target.findSatellite(ids[0]) && checkAVL(copy, copy.getRoot(), height) &&
+               copy.getBSTValidity(copy.getRoot()) && moved.findSatellite(MINID);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 29): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 30: Test that bulk loads, merges and copies split across SatWorkers match the serial ones.
+// Every ID comes twice with different altitudes, so a sort that is not
+// stable shows up as the wrong copy being kept.
+bool Tester::testParallelBuild(int n) {
+    try {
+        // every task of every job runs exactly once, also for jobs back to back
+        SatWorkers pool(4);
+        std::vector<std::atomic<int> > runs(64);
+        for (int job = 0; job < 500; job++) {
+            pool.run(job % 65, [&runs](int i) {
+                runs[i]++;
+            });
+        }
+        for (int i = 0; i < 64; i++) {
+            // task i runs in every job with more than i tasks
+            int expected = 0;
+            for (int job = 0; job < 500; job++) {
+                expected += (job % 65 > i);
+            }
+            if (runs[i] != expected) {
+                std::cerr << "Error (Test 30): task " << i << " ran " << runs[i] << " times, not " << expected << std::endl;
+                return false;
+            }
+        }
+
+        std::vector<Sat> batch;
+        for (int i = 0; i < n; i++) {
+            batch.push_back(Sat(MINID + 3 * i % (MAXID - MINID), MI340));
+            batch.push_back(Sat(MINID + 3 * i % (MAXID - MINID), MI208));
+        }
+        batch.push_back(Sat(MINID - 1));
+        batch.push_back(Sat(MAXID + 1));
+        std::shuffle(batch.begin(), batch.end(), std::mt19937(10));
+        std::vector<Sat> more;
+        for (int i = 0; i < n; i++) {
+            more.push_back(Sat(MINID + 3 * i % (MAXID - MINID) + 1, MI340));
+        }
+
+        SatNet serial;
+        SatLoadReport serialReport = serial.bulkLoad(batch);
+        SatNet serialMerged(serial);
+        SatLoadReport serialMerge = serialMerged.bulkMerge(more);
+
+        int threads[] = {1, 3, 8};
+        for (int t = 0; t < 3; t++) {
+            SatWorkers workers(threads[t]);
+            SatNet parallel;
+            SatLoadReport report = parallel.bulkLoad(batch, workers);
+            if (report.m_loaded != serialReport.m_loaded || report.m_duplicates != serialReport.m_duplicates ||
+                report.m_outOfRange != serialReport.m_outOfRange || !sameTree(serial, parallel)) {
+                std::cerr << "Error (Test 30): bulkLoad with " << threads[t] << " threads differs" << std::endl;
+                return false;
+            }
+
+            SatNet copy;
+            copy.insert(Sat(MINID));
+            copy.copyFrom(parallel, workers);
+            parallel.remove(MINID);
+            if (!sameTree(serial, copy) || parallel.findSatellite(MINID)) {
+                std::cerr << "Error (Test 30): copyFrom with " << threads[t] << " threads differs" << std::endl;
+                return false;
+            }
+
+            report = copy.bulkMerge(more, workers);
+            if (report.m_loaded != serialMerge.m_loaded || report.m_duplicates != serialMerge.m_duplicates ||
+                !sameTree(serialMerged, copy)) {
+                std::cerr << "Error (Test 30): bulkMerge with " << threads[t] << " threads differs" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 30): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 31: Test SatQuery histograms, counts and ID lists against a plain walk of the fleet.
+// The ranges include empty ones and ones that cut through the pieces the
+// tree is split into.
+bool Tester::testParallelQuery(SatNet& satNet, int n) {
+    try {
+        Random altGen(0, NUMALTS - 1);
+        Random inclinGen(0, NUMINCLINS - 1);
+        Random stateGen(0, NUMSTATES - 1);
+        std::vector<Sat> batch;
+        for (int i = 0; i < n; i++) {
+            batch.push_back(Sat(MINID + 4 * i, (ALT)altGen.getRandNum(), (INCLIN)inclinGen.getRandNum(),
+                                (STATE)stateGen.getRandNum()));
+        }
+        satNet.bulkLoad(batch);
+        std::vector<Sat> satellites;
+        satNet.flatten(satellites);
+
+        SatFilter decayingLow = SatFilter::state(DECAYING) & SatFilter::alt(MI208);
+        SatFilter polarOrActive = SatFilter::inclin(I97) | ~SatFilter::state(DEORBITED);
+        SatFilter odd = SatFilter::where([](ALT alt, INCLIN inclin, STATE state) {
+            return (alt + inclin + state) % 2 == 1;
+        });
+        SatFilter filters[] = {SatFilter(), SatFilter::none(), decayingLow, polarOrActive, odd};
+        int ranges[][2] = {{MINID, MAXID}, {MINID + 4001, MINID + 57003}, {MINID + 1, MINID + 3},
+                           {MINID + 4 * n / 2, MINID + 4 * n / 2}, {MAXID, MINID}};
+
+        int threads[] = {1, 4};
+        for (int t = 0; t < 2; t++) {
+            SatWorkers workers(threads[t]);
+            SatQuery query(satNet, workers);
+            for (int r = 0; r < 5; r++) {
+                int minID = ranges[r][0];
+                int maxID = ranges[r][1];
+                SatHistogram histogram = query.histogram(minID, maxID);
+                SatHistogram expectedHistogram;
+                for (size_t i = 0; i < satellites.size(); i++) {
+                    const Sat& satellite = satellites[i];
+                    if (satellite.getID() >= minID && satellite.getID() <= maxID) {
+                        expectedHistogram.m_cells[SatFilter::cell(satellite.getAlt(), satellite.getInclin(),
+                                                                  satellite.getState())]++;
+                    }
+                }
+                for (int c = 0; c < SatFilter::NUMCELLS; c++) {
+                    if (histogram.m_cells[c] != expectedHistogram.m_cells[c]) {
+                        std::cerr << "Error (Test 31): histogram cell " << c << " is wrong" << std::endl;
+                        return false;
+                    }
+                }
+                SatCounts counts = histogram.totals();
+                SatCounts expectedCounts = satNet.getCounts(minID, maxID);
+                for (int s = 0; s < NUMSTATES; s++) {
+                    if (counts.m_state[s] != expectedCounts.m_state[s]) {
+                        std::cerr << "Error (Test 31): histogram totals differ from getCounts" << std::endl;
+                        return false;
+                    }
+                }
+
+                for (int f = 0; f < 5; f++) {
+                    std::vector<int> expected;
+                    for (size_t i = 0; i < satellites.size(); i++) {
+                        const Sat& satellite = satellites[i];
+                        if (satellite.getID() >= minID && satellite.getID() <= maxID &&
+                            filters[f].matches(satellite.getAlt(), satellite.getInclin(), satellite.getState())) {
+                            expected.push_back(satellite.getID());
+                        }
+                    }
+                    if (query.findIDs(filters[f], minID, maxID) != expected ||
+                        query.count(filters[f], minID, maxID) != (int)expected.size()) {
+                        std::cerr << "Error (Test 31): filter " << f << " on range " << r << " with "
+                                  << threads[t] << " threads" << std::endl;
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 31): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 32: Test that the attribute index follows every kind of change to the tree.
+// After each step every set is compared with a walk of the tree, so a change
+// that misses the index shows up at the step that made it.
+bool Tester::testAttributeIndex(SatNet& satNet, int n) {
+    try {
+        Random idGen(MINID, MAXID);
+        Random attrGen(0, 11);
+        std::vector<int> ids;
+        for (int i = 0; i < n; i++) {
+            int id = idGen.getRandNum();
+            int attr = attrGen.getRandNum();
+            if (satNet.tryInsert(Sat(id, (ALT)(attr % NUMALTS), (INCLIN)(attr / 3), (STATE)(attr % NUMSTATES))) == SUCCESS) {
+                ids.push_back(id);
+            }
+        }
+        if (!indexMatchesTree(satNet)) {
+            std::cerr << "Error (Test 32): index differs after insert" << std::endl;
+            return false;
+        }
+
+        // removals hit leaves and nodes with two children alike
+        for (size_t i = 0; i < ids.size(); i += 3) {
+            satNet.remove(ids[i]);
+        }
+        satNet.remove(ids[0]);
+        for (size_t i = 1; i < ids.size(); i += 4) {
+            satNet.setState(ids[i], (STATE)(i % NUMSTATES));
+        }
+        if (!indexMatchesTree(satNet)) {
+            std::cerr << "Error (Test 32): index differs after remove and setState" << std::endl;
+            return false;
+        }
+
+        std::vector<STATE> states;
+        for (size_t i = 0; i < ids.size(); i++) {
+            states.push_back((STATE)((i / 2) % NUMSTATES));
+        }
+        satNet.setStates(ids.data(), states.data(), ids.size(), nullptr);
+        int removed = satNet.removeDeorbited();
+        if (!indexMatchesTree(satNet) || !satNet.getIDs(DEORBITED).empty() || removed == 0) {
+            std::cerr << "Error (Test 32): index differs after setStates and removeDeorbited" << std::endl;
+            return false;
+        }
+
+        // composed filters against the same filter written out by hand
+        SatIdSet decaying = satNet.getIDs(DECAYING) & satNet.getIDs(MI340);
+        SatIdSet either = satNet.getIDs(I97) | satNet.getIDs(MI208);
+        SatIdSet notActive = satNet.getIDs() - satNet.getIDs(ACTIVE);
+        std::vector<Sat> satellites;
+        satNet.flatten(satellites);
+        std::vector<int> expectedDecaying, expectedEither, expectedNotActive;
+        for (size_t i = 0; i < satellites.size(); i++) {
+            const Sat& satellite = satellites[i];
+            if (satellite.getState() == DECAYING && satellite.getAlt() == MI340) expectedDecaying.push_back(satellite.getID());
+            if (satellite.getInclin() == I97 || satellite.getAlt() == MI208) expectedEither.push_back(satellite.getID());
+            if (satellite.getState() != ACTIVE) expectedNotActive.push_back(satellite.getID());
+        }
+        if (decaying.ids() != expectedDecaying || either.ids() != expectedEither || notActive.ids() != expectedNotActive ||
+            decaying.size() != (int)expectedDecaying.size() || (decaying & SatIdSet()).size() != 0) {
+            std::cerr << "Error (Test 32): composed filters are wrong" << std::endl;
+            return false;
+        }
+
+        // copies own their index, moves take it along, bulk paths rebuild it
+        SatNet copy(satNet);
+        copy.setState(expectedNotActive[0], ACTIVE);
+        SatNet moved(std::move(copy));
+        SatNet merged;
+        merged.bulkLoad(satellites);
+        std::vector<Sat> more;
+        for (int i = 0; i < 50; i++) {
+            more.push_back(Sat(MINID + i, MI215, I53, DECAYING));
+        }
+        merged.bulkMerge(more);
+        if (!indexMatchesTree(satNet) || !indexMatchesTree(moved) || !indexMatchesTree(merged) ||
+            !copy.getIDs().empty() || satNet.getIDs(ACTIVE).contains(expectedNotActive[0]) ||
+            !moved.getIDs(ACTIVE).contains(expectedNotActive[0])) {
+            std::cerr << "Error (Test 32): index differs after copy, move or bulk load" << std::endl;
+            return false;
+        }
+        merged.clear();
+        if (!merged.getIDs().empty() || merged.getIDs(MI215).contains(MINID)) {
+            std::cerr << "Error (Test 32): index not empty after clear" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 32): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool Tester::indexMatchesTree(const SatNet& satNet) {
+    std::vector<Sat> satellites;
+    satNet.flatten(satellites);
+    std::vector<int> byState[NUMSTATES], byAlt[NUMALTS], byInclin[NUMINCLINS];
+    for (size_t i = 0; i < satellites.size(); i++) {
+        byState[satellites[i].getState()].push_back(satellites[i].getID());
+        byAlt[satellites[i].getAlt()].push_back(satellites[i].getID());
+        byInclin[satellites[i].getInclin()].push_back(satellites[i].getID());
+    }
+    for (int i = 0; i < NUMSTATES; i++) {
+        if (satNet.getIDs((STATE)i).ids() != byState[i]) return false;
+    }
+    for (int i = 0; i < NUMALTS; i++) {
+        if (satNet.getIDs((ALT)i).ids() != byAlt[i]) return false;
+    }
+    for (int i = 0; i < NUMINCLINS; i++) {
+        if (satNet.getIDs((INCLIN)i).ids() != byInclin[i]) return false;
+    }
+    return satNet.getIDs().size() == (int)satellites.size();
+}
+
+// TEST 33: Test in-order iterators, lower_bound/upper_bound/equal_range and forEachInRange(...).
+// Every bound is checked against std::lower_bound/std::upper_bound on the
+// sorted IDs, for IDs in the tree, between them and past either end.
+bool Tester::testIterators(SatNet& satNet, int n) {
+    try {
+        if (satNet.begin() != satNet.end() || satNet.lower_bound(MINID) != satNet.end()) {
+            std::cerr << "Error (Test 33): empty tree has a satellite to iterate" << std::endl;
+            return false;
+        }
+        std::vector<int> inserted = insertNSatellites(satNet, n);
+        std::vector<int> sorted(inserted);
+        std::sort(sorted.begin(), sorted.end());
+
+        // forwards, backwards from end() and through the STL algorithms
+        std::vector<int> forward;
+        for (SatNet::const_iterator it = satNet.begin(); it != satNet.end(); ++it) {
+            forward.push_back(it->getID());
+        }
+        std::vector<int> backward;
+        for (SatNet::const_iterator it = satNet.end(); it != satNet.begin();) {
+            --it;
+            backward.push_back((*it).getID());
+        }
+        std::reverse(backward.begin(), backward.end());
+        if (forward != sorted || backward != sorted ||
+            std::distance(satNet.begin(), satNet.end()) != (std::ptrdiff_t)sorted.size()) {
+            std::cerr << "Error (Test 33): iteration is not in ID order" << std::endl;
+            return false;
+        }
+        // a round trip from every position lands back on it
+        SatNet::const_iterator it = satNet.begin();
+        for (size_t i = 0; i < sorted.size(); i++, it++) {
+            SatNet::const_iterator next = it;
+            if (it.getID() != sorted[i] || --(++next) != it) {
+                std::cerr << "Error (Test 33): ++ and -- do not undo each other at " << sorted[i] << std::endl;
+                return false;
+            }
+        }
+
+        std::vector<int> probes;
+        probes.push_back(MINID - 5);
+        probes.push_back(MAXID + 5);
+        probes.push_back(sorted.front());
+        probes.push_back(sorted.back());
+        for (size_t i = 0; i < sorted.size(); i += 7) {
+            probes.push_back(sorted[i]);
+            probes.push_back(sorted[i] + 1);
+            probes.push_back(sorted[i] - 1);
+        }
+        for (size_t i = 0; i < probes.size(); i++) {
+            int id = probes[i];
+            size_t lower = std::lower_bound(sorted.begin(), sorted.end(), id) - sorted.begin();
+            size_t upper = std::upper_bound(sorted.begin(), sorted.end(), id) - sorted.begin();
+            std::pair<SatNet::const_iterator, SatNet::const_iterator> range = satNet.equal_range(id);
+            if (std::distance(satNet.begin(), satNet.lower_bound(id)) != (std::ptrdiff_t)lower ||
+                std::distance(satNet.begin(), satNet.upper_bound(id)) != (std::ptrdiff_t)upper ||
+                std::distance(range.first, range.second) != (std::ptrdiff_t)(upper - lower) ||
+                (lower < sorted.size() && satNet.lower_bound(id).getID() != sorted[lower])) {
+                std::cerr << "Error (Test 33): bounds of " << id << " are wrong" << std::endl;
+                return false;
+            }
+        }
+
+        // blocks of IDs, including empty and one-ID blocks and blocks past the ends
+        int blocks[][2] = {{MINID, MAXID}, {sorted[10], sorted[500]}, {sorted[20], sorted[20]},
+                           {sorted[30] + 1, sorted[31] - 1}, {MINID - 100, sorted[5]}, {sorted[n - 3], MAXID + 100},
+                           {sorted[50], sorted[40]}};
+        for (int b = 0; b < 7; b++) {
+            std::vector<int> visited;
+            SatCounts counts;
+            satNet.forEachInRange(blocks[b][0], blocks[b][1], [&visited, &counts](const Sat& satellite) {
+                visited.push_back(satellite.getID());
+                counts.add(satellite.getState(), satellite.getAlt(), satellite.getInclin());
+            });
+            std::vector<int> expected;
+            for (SatNet::const_iterator at = satNet.lower_bound(blocks[b][0]); at != satNet.upper_bound(blocks[b][1]) &&
+                 blocks[b][0] <= blocks[b][1]; ++at) {
+                expected.push_back(at.getID());
+            }
+            SatCounts expectedCounts = satNet.getCounts(blocks[b][0], blocks[b][1]);
+            if (visited != expected || counts.m_alt[MI208] != expectedCounts.m_alt[MI208] ||
+                counts.total() != expectedCounts.total()) {
+                std::cerr << "Error (Test 33): forEachInRange over block " << b << " is wrong" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 33): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 34: Test buffered listSatellites(...) and dumpTree(...) in every format and to every kind of sink.
+// The expected text is built line by line with the Sat string getters, the
+// way listSatellites() used to print; 3000 lines are more than one buffer.
+bool Tester::testListingOutput(SatNet& satNet, int n) {
+    try {
+        Random altGen(0, NUMALTS - 1);
+        Random inclinGen(0, NUMINCLINS - 1);
+        Random stateGen(0, NUMSTATES - 1);
+        SatTable satTable;
+        std::vector<int> ids = insertNSatellites(satNet, n);
+        for (size_t i = 0; i < ids.size(); i++) {
+            satNet.remove(ids[i]);
+            Sat satellite(ids[i], (ALT)altGen.getRandNum(), (INCLIN)inclinGen.getRandNum(), (STATE)stateGen.getRandNum());
+            satNet.insert(satellite);
+            satTable.insert(satellite);
+        }
+        std::vector<Sat> satellites;
+        satNet.flatten(satellites);
+
+        std::ostringstream text, csv, jsonl, dump;
+        csv << "id,state,inclination,altitude\n";
+        for (size_t i = 0; i < satellites.size(); i++) {
+            const Sat& satellite = satellites[i];
+            std::string inclin = satellite.getInclinStr().substr(0, 2);
+            std::string alt = satellite.getAltStr().substr(0, 3);
+            text << satellite.getID() << ": " << satellite.getStateStr() << ": " << satellite.getInclinStr() << ": "
+                 << satellite.getAltStr() << "\n";
+            csv << satellite.getID() << "," << satellite.getStateStr() << "," << inclin << "," << alt << "\n";
+            jsonl << "{\"id\":" << satellite.getID() << ",\"state\":\"" << satellite.getStateStr()
+                  << "\",\"inclination\":" << inclin << ",\"altitude\":" << alt << "}\n";
+        }
+
+        // the cout versions keep printing what they always did
+        std::ostringstream captured;
+        std::streambuf* saved = std::cout.rdbuf(captured.rdbuf());
+        satNet.listSatellites();
+        std::string listed = captured.str();
+        captured.str("");
+        satNet.dumpTree();
+        std::string dumped = captured.str();
+        captured.str("");
+        satTable.listSatellites();
+        std::string tableListed = captured.str();
+        std::cout.rdbuf(saved);
+        if (listed != text.str() || tableListed != text.str() || dumped.size() < satellites.size() * 8 ||
+            dumped[0] != '(' || dumped[dumped.size() - 1] != ')') {
+            std::cerr << "Error (Test 34): listing to cout changed" << std::endl;
+            return false;
+        }
+
+        FORMAT formats[] = {TEXT, CSV, JSONL};
+        std::string expected[] = {text.str(), csv.str(), jsonl.str()};
+        for (int f = 0; f < 3; f++) {
+            // a stream, a callback that sees every chunk, and a file descriptor
+            std::ostringstream stream;
+            {
+                SatWriter out(stream);
+                satNet.listSatellites(out, formats[f]);
+            }
+            std::string chunks;
+            int calls = 0;
+            SatWriter callback([&chunks, &calls](const char* data, size_t size) {
+                chunks.append(data, size);
+                calls++;
+            });
+            satTable.listSatellites(callback, formats[f]);
+            if (stream.str() != expected[f] || chunks != expected[f] || calls > (int)(chunks.size() / 32768) + 1) {
+                std::cerr << "Error (Test 34): listing in format " << f << " is wrong" << std::endl;
+                return false;
+            }
+        }
+        char path[] = "/tmp/satlistXXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0) {
+            std::cerr << "Error (Test 34): no temporary file" << std::endl;
+            return false;
+        }
+        {
+            SatWriter out(fd);
+            satNet.listSatellites(out, JSONL);
+            satNet.dumpTree(out);
+        }
+        close(fd);
+        std::ifstream file(path);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        unlink(path);
+        if (contents.str() != jsonl.str() + dumped) {
+            std::cerr << "Error (Test 34): listing to a file descriptor is wrong" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 34): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// TEST 35: Test saveSnapshot/loadSnapshot round trips, in-place SatImage lookups and damaged files.
+// Every damaged file must be rejected by loadSnapshot without touching the
+// tree it was loaded into.
+bool Tester::testSnapshotFile(SatNet& satNet, int n) {
+    char directory[] = "/tmp/satimageXXXXXX";
+    if (mkdtemp(directory) == nullptr) {
+        std::cerr << "Error (Test 35): no temporary directory" << std::endl;
+        return false;
+    }
+    std::string path = std::string(directory) + "/fleet.sat";
+    std::string damaged = std::string(directory) + "/damaged.sat";
+    bool passed = true;
+    try {
+        Random attrGen(0, 47);
+        std::vector<int> ids = insertNSatellites(satNet, n);
+        for (size_t i = 0; i < ids.size(); i++) {
+            int attr = attrGen.getRandNum();
+            satNet.setState(ids[i], (STATE)(attr % NUMSTATES));
+            if (attr % 2 == 0) {
+                satNet.remove(ids[i]);
+                satNet.insert(Sat(ids[i], (ALT)(attr / 12), (INCLIN)(attr / 3 % NUMINCLINS), (STATE)(attr % NUMSTATES)));
+            }
+        }
+        satNet.saveSnapshot(path);
+
+        SatNet loaded;
+        loaded.insert(Sat(MINID));
+        loaded.loadSnapshot(path);
+        int height = 0;
+        if (!sameTree(satNet, loaded) || !checkAVL(loaded, loaded.getRoot(), height) || !indexMatchesTree(loaded)) {
+            std::cerr << "Error (Test 35): loaded fleet differs" << std::endl;
+            passed = false;
+        }
+        std::vector<Sat> expected, actual;
+        satNet.flatten(expected);
+        loaded.flatten(actual);
+        for (size_t i = 0; passed && i < expected.size(); i++) {
+            if (actual[i].getState() != expected[i].getState() || actual[i].getInclin() != expected[i].getInclin()) {
+                std::cerr << "Error (Test 35): satellite " << expected[i].getID() << " loaded differently" << std::endl;
+                passed = false;
+            }
+        }
+
+        // lookups straight from the mapped file
+        SatImage image(path);
+        for (size_t i = 0; passed && i < expected.size(); i++) {
+            STATE state = ACTIVE;
+            if (!image.getState(expected[i].getID(), state) || state != expected[i].getState() ||
+                image.satellite((int)i).getAlt() != expected[i].getAlt() || image.findSatellite(expected[i].getID() + 1) !=
+                satNet.findSatellite(expected[i].getID() + 1)) {
+                std::cerr << "Error (Test 35): in-place lookup of " << expected[i].getID() << " is wrong" << std::endl;
+                passed = false;
+            }
+        }
+        if (image.size() != (int)expected.size() || image.findSatellite(MINID - 1) || image.findSatellite(MAXID + 1)) {
+            std::cerr << "Error (Test 35): image size or bounds are wrong" << std::endl;
+            passed = false;
+        }
+
+        // a copy of the file with one change each: a flipped record bit, a
+        // cut-off end, another magic, another version, and an ID out of order
+        std::ifstream in(path, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        size_t records = 24;
+        std::vector<std::string> variants(5, bytes);
+        variants[0][records + 4 * (n / 4) + 1] ^= 0x04;
+        variants[1].resize(bytes.size() - 2);
+        variants[2][0] = 'X';
+        variants[3][8] = 9;
+        std::swap(variants[4][records + 4], variants[4][records + 8]);
+        for (size_t v = 0; passed && v < variants.size(); v++) {
+            std::ofstream out(damaged, std::ios::binary | std::ios::trunc);
+            out << variants[v];
+            out.close();
+            bool threw = false;
+            try {
+                loaded.loadSnapshot(damaged);
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            if (!threw || !sameTree(satNet, loaded)) {
+                std::cerr << "Error (Test 35): damaged file " << v << " was not rejected cleanly" << std::endl;
+                passed = false;
+            }
+        }
+        bool threw = false;
+        try {
+            loaded.loadSnapshot(std::string(directory) + "/missing.sat");
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+
+        // an empty fleet round-trips too
+        SatNet empty;
+        empty.saveSnapshot(path);
+        loaded.loadSnapshot(path);
+        if (!threw || loaded.getRoot() != NOSAT || !loaded.getIDs().empty()) {
+            std::cerr << "Error (Test 35): missing file or empty fleet handled wrongly" << std::endl;
+            passed = false;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 35): " << e.what() << std::endl;
+        passed = false;
+    }
+    unlink(path.c_str());
+    unlink(damaged.c_str());
+    rmdir(directory);
+    return passed;
+}
+
+// TEST 36: Test JournaledSatNet recovery: replay, checkpoints, torn groups, stale logs and group commit.
+// A plain SatNet gets the same changes and is what every reopened fleet
+// must match. Reopening stands in for a restart after a crash. A stale log,
+// or one whose snapshot is gone, must be refused and left untouched, and a
+// change the log rejects, or one after a failed checkpoint, must not reach
+// the fleet.
+bool Tester::testJournal(int n) {
+    char directory[] = "/tmp/satjournalXXXXXX";
+    if (mkdtemp(directory) == nullptr) {
+        std::cerr << "Error (Test 36): no temporary directory" << std::endl;
+        return false;
+    }
+    std::string snapshot = std::string(directory) + "/fleet.sat";
+    std::string journal = std::string(directory) + "/fleet.log";
+    bool passed = true;
+    try {
+        Random idGen(MINID, MAXID);
+        Random opGen(0, 9);
+        SatNet expected;
+        {
+            // small changes one at a time, in groups of 16
+            JournaledSatNet fleet(snapshot, journal, 16);
+            for (int i = 0; i < n; i++) {
+                int id = idGen.getRandNum();
+                int op = opGen.getRandNum();
+                if (op < 6) {
+                    Sat satellite(id, (ALT)(op % NUMALTS), (INCLIN)(id % NUMINCLINS), (STATE)(id % NUMSTATES));
+                    fleet.tryInsert(satellite);
+                    expected.tryInsert(satellite);
+                } else if (op < 8) {
+                    fleet.setState(id, (STATE)(op % NUMSTATES));
+                    expected.setState(id, (STATE)(op % NUMSTATES));
+                    fleet.remove(id + 1);
+                    expected.remove(id + 1);
+                } else if (i % 500 == 0) {
+                    fleet.removeDeorbited();
+                    expected.removeDeorbited();
+                }
+            }
+        }
+        std::vector<Sat> bulk;
+        {
+            JournaledSatNet fleet(snapshot, journal);
+            if (fleet.replayed() == 0 || !sameSatellites(expected, fleet.fleet())) {
+                std::cerr << "Error (Test 36): replayed fleet differs" << std::endl;
+                passed = false;
+            }
+            // long runs of one operation, which replay as batches
+            for (int id = MINID; id < MINID + 3 * n; id += 3) {
+                bulk.push_back(Sat(id, MI350, I70, DECAYING));
+                fleet.tryInsert(bulk.back());
+                expected.tryInsert(bulk.back());
+            }
+            for (int id = MINID; id < MINID + 3 * n; id += 2) {
+                fleet.remove(id);
+                expected.remove(id);
+            }
+            for (int id = MINID + 1; id < MINID + 3 * n; id += 5) {
+                fleet.setState(id, DEORBITED);
+                expected.setState(id, DEORBITED);
+            }
+            fleet.commit();
+        }
+        {
+            JournaledSatNet fleet(snapshot, journal);
+            if (!sameSatellites(expected, fleet.fleet())) {
+                std::cerr << "Error (Test 36): batched replay differs" << std::endl;
+                passed = false;
+            }
+            // after a checkpoint only the later changes are in the log
+            fleet.checkpoint();
+            fleet.insert(Sat(MAXID, MI215));
+            expected.insert(Sat(MAXID, MI215));
+        }
+        std::vector<char> stale;
+        {
+            JournaledSatNet fleet(snapshot, journal);
+            if (fleet.replayed() != 1 || !sameSatellites(expected, fleet.fleet())) {
+                std::cerr << "Error (Test 36): fleet differs after checkpoint" << std::endl;
+                passed = false;
+            }
+            // keep this log to bring it back as if a checkpoint crashed before resetting it
+            std::ifstream in(journal, std::ios::binary);
+            stale.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            fleet.removeDeorbited();
+            expected.removeDeorbited();
+            fleet.checkpoint();
+        }
+        {
+            std::ofstream out(journal, std::ios::binary | std::ios::trunc);
+            out.write(stale.data(), stale.size());
+        }
+        // a log older than the snapshot, with nothing to say a checkpoint took
+        // it in, is refused and left as it is
+        if (!journalRefused(snapshot, journal, stale)) {
+            std::cerr << "Error (Test 36): a log older than the snapshot was opened" << std::endl;
+            passed = false;
+        }
+        unlink(journal.c_str());
+        {
+            JournaledSatNet fleet(snapshot, journal);
+            if (fleet.replayed() != 0 || !sameSatellites(expected, fleet.fleet())) {
+                std::cerr << "Error (Test 36): fleet differs without a log" << std::endl;
+                passed = false;
+            }
+            fleet.setState(MAXID, DECAYING);
+            expected.setState(MAXID, DECAYING);
+            // a checkpoint that crashes after writing the snapshot, before
+            // restarting the log; the log still holds the setState
+            std::vector<Sat> sorted(fleet.fleet().begin(), fleet.fleet().end());
+            fleet.m_journal.prepare(SatImage::checksum(sorted));
+            SatImage::save(snapshot, sorted);
+        }
+        {
+            JournaledSatNet fleet(snapshot, journal);
+            if (fleet.replayed() != 0 || !sameSatellites(expected, fleet.fleet())) {
+                std::cerr << "Error (Test 36): a log the snapshot took in was applied" << std::endl;
+                passed = false;
+            }
+            fleet.setState(MAXID, ACTIVE);
+            expected.setState(MAXID, ACTIVE);
+        }
+        {
+            // a group cut short: its half is dropped, and new groups follow the intact ones
+            std::ofstream out(journal, std::ios::binary | std::ios::app);
+            char torn[] = {5, 0, 0, 0, 1, 2, 3, 4, 9, 9};
+            out.write(torn, sizeof(torn));
+        }
+        {
+            JournaledSatNet fleet(snapshot, journal);
+            if (fleet.replayed() != 1 || !sameSatellites(expected, fleet.fleet())) {
+                std::cerr << "Error (Test 36): torn group was not ignored" << std::endl;
+                passed = false;
+            }
+            fleet.insert(Sat(MAXID - 1));
+            expected.insert(Sat(MAXID - 1));
+        }
+        {
+            JournaledSatNet fleet(snapshot, journal);
+            if (fleet.replayed() != 2 || !sameSatellites(expected, fleet.fleet())) {
+                std::cerr << "Error (Test 36): log not usable after cutting a torn group" << std::endl;
+                passed = false;
+            }
+        }
+        {
+            // without its snapshot the log would be started afresh on top of
+            // nothing, losing both; it is refused and left as it is instead
+            std::ifstream in(journal, std::ios::binary);
+            std::vector<char> log((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            std::string moved = snapshot + ".moved";
+            rename(snapshot.c_str(), moved.c_str());
+            if (!journalRefused(snapshot, journal, log)) {
+                std::cerr << "Error (Test 36): a log was opened without its snapshot" << std::endl;
+                passed = false;
+            }
+            rename(moved.c_str(), snapshot.c_str());
+        }
+        {
+            // a change that cannot be logged is not applied either
+            JournaledSatNet fleet(snapshot, journal);
+            fleet.m_journal.m_failed = true;
+            int absent = MINID;
+            while (expected.findSatellite(absent)) {
+                absent++;
+            }
+            int threw = 0;
+            try {fleet.insert(Sat(absent));} catch (const std::runtime_error&) {threw++;}
+            try {fleet.tryInsert(Sat(absent));} catch (const std::runtime_error&) {threw++;}
+            try {fleet.tryRemove(MAXID);} catch (const std::runtime_error&) {threw++;}
+            try {fleet.setState(MAXID, DEORBITED);} catch (const std::runtime_error&) {threw++;}
+            if (threw != 4 || !sameSatellites(expected, fleet.fleet())) {
+                std::cerr << "Error (Test 36): a change was applied although it could not be logged" << std::endl;
+                passed = false;
+            }
+        }
+        {
+            JournaledSatNet fleet(snapshot, journal);
+            if (fleet.replayed() != 2 || !sameSatellites(expected, fleet.fleet())) {
+                std::cerr << "Error (Test 36): a failed change reached the log" << std::endl;
+                passed = false;
+            }
+            // a checkpoint whose snapshot cannot be written leaves the log
+            // failed, so nothing is committed under the checkpoint it named
+            std::string blocked = std::string(directory) + "/blocked";
+            mkdir(blocked.c_str(), 0755);
+            fleet.m_snapshotPath = blocked;
+            int threw = 0;
+            try {fleet.checkpoint();} catch (const std::runtime_error&) {threw++;}
+            try {fleet.setState(MAXID, DEORBITED);} catch (const std::runtime_error&) {threw++;}
+            rmdir(blocked.c_str());
+            if (threw != 2 || fleet.fleet().countSatellites(DEORBITED) != expected.countSatellites(DEORBITED)) {
+                std::cerr << "Error (Test 36): a change was logged after a failed checkpoint" << std::endl;
+                passed = false;
+            }
+        }
+        {
+            JournaledSatNet fleet(snapshot, journal);
+            if (fleet.replayed() != 2 || !sameSatellites(expected, fleet.fleet())) {
+                std::cerr << "Error (Test 36): a failed checkpoint lost the log" << std::endl;
+                passed = false;
+            }
+        }
+
+        // group commit: threads logging and committing at once lose nothing
+        std::string shared = std::string(directory) + "/shared.log";
+        {
+            SatJournal log(shared, 0);
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; t++) {
+                threads.push_back(std::thread([&log, t]() {
+                    for (int i = 0; i < 100; i++) {
+                        log.logInsert(Sat(MINID + 100 * t + i));
+                        log.commit();
+                    }
+                }));
+            }
+            for (size_t t = 0; t < threads.size(); t++) {
+                threads[t].join();
+            }
+            if (log.pending() != 0) {
+                passed = false;
+            }
+        }
+        SatNet replayed;
+        if (SatJournal::replay(shared, 0, replayed) != 400 || replayed.getIDs().size() != 400 ||
+            SatJournal::replay(shared, 1, replayed) != 0) {
+            std::cerr << "Error (Test 36): group commit lost records" << std::endl;
+            passed = false;
+        }
+        unlink(shared.c_str());
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 36): " << e.what() << std::endl;
+        passed = false;
+    }
+    unlink(snapshot.c_str());
+    unlink(journal.c_str());
+    rmdir(directory);
+    return passed;
+}
+
+bool Tester::journalRefused(const std::string& snapshot, const std::string& journal, const std::vector<char>& log) {
+    bool refused = false;
+    try {
+        JournaledSatNet fleet(snapshot, journal);
+    } catch (const std::runtime_error&) {
+        refused = true;
+    }
+    std::ifstream in(journal, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return refused && bytes == log;
+}
+
+bool Tester::sameSatellites(const SatNet& expected, const SatNet& satNet) {
+    std::vector<Sat> lhs, rhs;
+    expected.flatten(lhs);
+    satNet.flatten(rhs);
+    if (lhs.size() != rhs.size() || !sameTree(expected, satNet) || !indexMatchesTree(satNet)) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); i++) {
+        if (lhs[i].getID() != rhs[i].getID() || lhs[i].getAlt() != rhs[i].getAlt() ||
+            lhs[i].getInclin() != rhs[i].getInclin() || lhs[i].getState() != rhs[i].getState()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// TEST 37: Test SatIngest: CSV round trips, column headers, bad lines, duplicates and chunk boundaries.
+// A listing written as CSV loads back into the same fleet, through small
+// batches and chunks as well as the defaults. A hand-written catalog checks
+// every kind of bad line, spaces, CRLF, a last line without a newline and
+// lines longer than a chunk.
+bool Tester::testIngest(SatNet& satNet, int n) {
+    char directory[] = "/tmp/satingestXXXXXX";
+    if (mkdtemp(directory) == nullptr) {
+        std::cerr << "Error (Test 37): no temporary directory" << std::endl;
+        return false;
+    }
+    std::string listing = std::string(directory) + "/fleet.csv";
+    std::string catalog = std::string(directory) + "/catalog.csv";
+    bool passed = true;
+    try {
+        Random attrGen(0, 47);
+        std::vector<int> ids = insertNSatellites(satNet, n);
+        for (size_t i = 0; i < ids.size(); i++) {
+            int attr = attrGen.getRandNum();
+            satNet.remove(ids[i]);
+            satNet.insert(Sat(ids[i], (ALT)(attr / 12), (INCLIN)(attr / 3 % NUMINCLINS), (STATE)(attr % NUMSTATES)));
+        }
+        {
+            std::ofstream out(listing);
+            SatWriter writer(out);
+            satNet.listSatellites(writer, CSV);
+        }
+        SatNet small;
+        SatIngestReport report = SatIngest(97, 4096).load(listing, small);
+        if (!sameSatellites(satNet, small) || report.m_loaded != n || report.m_lines != n + 1 ||
+            report.m_duplicates != 0 || report.m_malformed != 0 || report.m_outOfRange != 0) {
+            std::cerr << "Error (Test 37): CSV listing did not load back in small batches" << std::endl;
+            passed = false;
+        }
+        SatNet large;
+        report = SatIngest().load(listing, large);
+        if (!sameSatellites(satNet, large) || report.m_loaded != n) {
+            std::cerr << "Error (Test 37): CSV listing did not load back in one batch" << std::endl;
+            passed = false;
+        }
+        // loading it again finds every satellite already there
+        report = SatIngest(1000).load(listing, large);
+        if (!sameSatellites(satNet, large) || report.m_loaded != 0 || report.m_duplicates != n) {
+            std::cerr << "Error (Test 37): a second load was not all duplicates" << std::endl;
+            passed = false;
+        }
+
+        // no header, so the default column order; lines 5 and 8-10 are
+        // malformed, 6 and 11 out of range, 7 and 12 duplicates
+        {
+            std::ofstream out(catalog);
+            out << "10001,208,48,Active\n"
+                << " 10002 , MI215 , I53 , deorbited \r\n"
+                << "\n"
+                << "# comment\n"
+                << "10003,209,48,Active\n"
+                << "9999,208,48,Active\n"
+                << "10001,350,97,Decaying\n"
+                << "10004,208,48\n"
+                << "10005,208,48,Active,extra\n"
+                << "1x006,208,48,Active\n"
+                << "100000,208,48,Active\n"
+                << "10006,340,70,DECAYING";
+        }
+        SatNet mixed;
+        mixed.insert(Sat(10006, MI208, I48, ACTIVE));
+        report = SatIngest(2, 8).load(catalog, mixed);
+        long badLines[] = {5, 6, 8, 9, 10, 11};
+        if (report.m_lines != 12 || report.m_loaded != 2 || report.m_duplicates != 2 || report.m_outOfRange != 2 ||
+            report.m_malformed != 4 || report.m_badLines != std::vector<long>(badLines, badLines + 6)) {
+            std::cerr << "Error (Test 37): wrong counts for the hand-written catalog" << std::endl;
+            passed = false;
+        }
+        SatNet expected;
+        expected.insert(Sat(10001, MI208, I48, ACTIVE));
+        expected.insert(Sat(10002, MI215, I53, DEORBITED));
+        expected.insert(Sat(10006, MI208, I48, ACTIVE));
+        if (!sameSatellites(expected, mixed)) {
+            std::cerr << "Error (Test 37): the hand-written catalog loaded the wrong satellites" << std::endl;
+            passed = false;
+        }
+
+        // a header in another order with a column to skip
+        {
+            std::ofstream out(catalog);
+            out << "State, Name, ID, Inclination, Alt\nDecaying,Sat A,20000,97,350\n";
+        }
+        SatNet reordered;
+        report = SatIngest().load(catalog, reordered);
+        SatNet single;
+        single.insert(Sat(20000, MI350, I97, DECAYING));
+        if (report.m_loaded != 1 || !sameSatellites(single, reordered)) {
+            std::cerr << "Error (Test 37): header column order was not followed" << std::endl;
+            passed = false;
+        }
+
+        // a damaged first row names no id column, so it is a bad line and
+        // the rest still load in the default order
+        {
+            std::ofstream out(catalog);
+            out << "# catalog\nx20001,208,48,Active\n20002,215,53,Decaying\nActive,208\n";
+        }
+        SatNet damaged;
+        report = SatIngest().load(catalog, damaged);
+        SatNet second;
+        second.insert(Sat(20002, MI215, I53, DECAYING));
+        if (report.m_loaded != 1 || report.m_malformed != 2 || report.m_badLines != std::vector<long>({2, 4}) ||
+            !sameSatellites(second, damaged)) {
+            std::cerr << "Error (Test 37): a malformed first row was not counted as a bad line" << std::endl;
+            passed = false;
+        }
+
+        // a header without a state column, and a missing file
+        {
+            std::ofstream out(catalog);
+            out << "id,altitude,inclination\n20000,350,97\n";
+        }
+        bool thrown = false;
+        try {
+            SatIngest().load(catalog, reordered);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        bool missing = false;
+        try {
+            SatIngest().load(std::string(directory) + "/missing.csv", reordered);
+        } catch (const std::runtime_error&) {
+            missing = true;
+        }
+        if (!thrown || !missing) {
+            std::cerr << "Error (Test 37): a bad header or a missing file did not throw" << std::endl;
+            passed = false;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 37): " << e.what() << std::endl;
+        passed = false;
+    }
+    unlink(listing.c_str());
+    unlink(catalog.c_str());
+    rmdir(directory);
+    return passed;
+}
+
+// TEST 38: Test SatNet::stats(): rotations, descents, pool traffic, retraces, latencies and reset.
+// Without SATNET_STATS every counter must stay zero. With it, ascending
+// inserts rotate only singly and insert 3, 1, 2 needs one double rotation;
+// each call counts one descent no longer than an AVL tree is high, and the
+// pool counts match the inserts, removes and clear. The batched find and
+// setState count a call and a descent per ID, and removeDeorbited, removeIf,
+// bulkLoad over a tree and loadSnapshot count the nodes they give back.
+bool Tester::testStats(SatNet& satNet, int n) {
+    bool passed = true;
+    try {
+        for (int i = 0; i < n; i++) {
+            satNet.insert(Sat(MINID + i));
+        }
+        for (int i = 0; i < n; i++) {
+            satNet.findSatellite(MINID + i);
+            satNet.setState(MINID + i, DECAYING);
+        }
+        SatNetStats stats = satNet.stats();
+        std::ostringstream dump;
+        stats.dump(dump);
+        if (!SatNetStats::ENABLED) {
+            if (stats.m_descents != 0 || stats.m_calls[SatNetStats::INSERT] != 0 ||
+                dump.str().find("enabled 0\n") != 0) {
+                std::cerr << "Error (Test 38): counters moved in a build without SATNET_STATS" << std::endl;
+                passed = false;
+            }
+            return passed;
+        }
+
+        // an AVL tree of n nodes is under 1.45 log2(n + 2) levels high
+        uint64_t height = (uint64_t)(1.45 * log2(n + 2.0)) + 1;
+        uint64_t buckets = 0;
+        for (int b = 0; b < SatNetStats::LATENCYBUCKETS; b++) {
+            buckets += stats.m_latency[SatNetStats::FIND][b];
+        }
+        if (stats.m_singleRotations == 0 || stats.m_doubleRotations != 0 || stats.m_allocations != (uint64_t)n ||
+            stats.m_frees != 0 || stats.m_retraces != (uint64_t)n || stats.m_descents != 3 * (uint64_t)n ||
+            stats.m_longestDescent > height || stats.m_nodesVisited > stats.m_descents * height ||
+            stats.m_deepestRetrace > height || stats.m_retraceLevels < stats.m_singleRotations) {
+            std::cerr << "Error (Test 38): tree counters are wrong after ascending inserts" << std::endl;
+            passed = false;
+        }
+        if (stats.m_calls[SatNetStats::INSERT] != (uint64_t)n || stats.m_calls[SatNetStats::FIND] != (uint64_t)n ||
+            stats.m_calls[SatNetStats::SETSTATE] != (uint64_t)n || stats.m_calls[SatNetStats::REMOVE] != 0 ||
+            buckets != (uint64_t)n || stats.percentileNs(SatNetStats::FIND, 0.5) == 0 ||
+            stats.percentileNs(SatNetStats::FIND, 0.5) > stats.percentileNs(SatNetStats::FIND, 0.99) ||
+            dump.str().find("find.calls " + std::to_string(n) + "\n") == std::string::npos) {
+            std::cerr << "Error (Test 38): call counts or latencies are wrong" << std::endl;
+            passed = false;
+        }
+
+        // a copy starts from zero; reset zeroes the original
+        SatNet copy(satNet);
+        satNet.resetStats();
+        if (copy.stats().m_descents != 0 || satNet.stats().m_singleRotations != 0 ||
+            satNet.stats().m_calls[SatNetStats::INSERT] != 0) {
+            std::cerr << "Error (Test 38): copy or reset kept counts" << std::endl;
+            passed = false;
+        }
+
+        SatNet small;
+        small.insert(Sat(MINID + 3));
+        small.insert(Sat(MINID + 1));
+        small.insert(Sat(MINID + 2));
+        small.tryInsert(Sat(MINID + 2));
+        if (small.stats().m_doubleRotations != 1 || small.stats().m_singleRotations != 0 ||
+            small.stats().m_allocations != 3 || small.stats().m_calls[SatNetStats::INSERT] != 4) {
+            std::cerr << "Error (Test 38): insert 3, 1, 2 did not count one double rotation" << std::endl;
+            passed = false;
+        }
+
+        for (int i = 0; i < n / 2; i++) {
+            satNet.remove(MINID + i);
+        }
+        satNet.clear();
+        stats = satNet.stats();
+        if (stats.m_frees != (uint64_t)n || stats.m_calls[SatNetStats::REMOVE] != (uint64_t)(n / 2) ||
+            stats.m_descents != (uint64_t)(n / 2)) {
+            std::cerr << "Error (Test 38): removes and clear did not count every free" << std::endl;
+            passed = false;
+        }
+
+        // setStates walks to each node, then again along the path of each
+        // changed one to move its counts
+        satNet.resetStats();
+        std::vector<int> ids(n);
+        std::vector<STATE> states(n, DEORBITED);
+        std::unique_ptr<bool[]> out(new bool[n]);
+        for (int i = 0; i < n; i++) {
+            ids[i] = MINID + i;
+            satNet.insert(Sat(MINID + i));
+        }
+        satNet.setStates(ids.data(), states.data(), n / 2, out.get());
+        satNet.findSatellites(ids.data(), n, out.get());
+        stats = satNet.stats();
+        buckets = 0;
+        for (int b = 0; b < SatNetStats::LATENCYBUCKETS; b++) {
+            buckets += stats.m_latency[SatNetStats::SETSTATE][b];
+        }
+        if (stats.m_calls[SatNetStats::SETSTATE] != (uint64_t)(n / 2) || buckets != (uint64_t)(n / 2) ||
+            stats.m_calls[SatNetStats::FIND] != (uint64_t)n || stats.m_descents != 3 * (uint64_t)n ||
+            stats.m_longestDescent > height || stats.m_nodesVisited > stats.m_descents * height) {
+            std::cerr << "Error (Test 38): setStates or findSatellites did not count each ID" << std::endl;
+            passed = false;
+        }
+
+        satNet.resetStats();
+        int removed = satNet.removeDeorbited();
+        removed += satNet.removeIf([](const Sat& satellite) {return satellite.getID() % 2 == 0;});
+        stats = satNet.stats();
+        if (removed == 0 || stats.m_frees != (uint64_t)removed) {
+            std::cerr << "Error (Test 38): removeDeorbited or removeIf did not count its frees" << std::endl;
+            passed = false;
+        }
+        satNet.clear();
+        if (satNet.stats().m_frees != (uint64_t)n) {
+            std::cerr << "Error (Test 38): removeIf and clear did not free every node once" << std::endl;
+            passed = false;
+        }
+
+        // a bulk load over a tree frees the old nodes as it builds the new
+        SatNet loaded;
+        std::vector<Sat> satellites;
+        for (int i = 0; i < n; i++) {
+            satellites.push_back(Sat(MINID + i));
+        }
+        for (int i = 0; i < n / 4; i++) {
+            loaded.insert(Sat(MAXID - i));
+        }
+        loaded.bulkLoad(satellites);
+        stats = loaded.stats();
+        if (stats.m_allocations != (uint64_t)(n + n / 4) || stats.m_frees != (uint64_t)(n / 4)) {
+            std::cerr << "Error (Test 38): bulkLoad over a tree miscounted the pool" << std::endl;
+            passed = false;
+        }
+
+        char path[] = "/tmp/satstatsXXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0) {
+            throw std::runtime_error("cannot create a snapshot file");
+        }
+        close(fd);
+        loaded.saveSnapshot(path);
+        SatNet restored;
+        for (int i = 0; i < n / 4; i++) {
+            restored.insert(Sat(MAXID - i));
+        }
+        restored.loadSnapshot(path);
+        unlink(path);
+        stats = restored.stats();
+        if (stats.m_allocations != (uint64_t)(n + n / 4) || stats.m_frees != (uint64_t)(n / 4)) {
+            std::cerr << "Error (Test 38): loadSnapshot over a tree miscounted the pool" << std::endl;
+            passed = false;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 38): " << e.what() << std::endl;
+        passed = false;
+    }
+    return passed;
+}
+
+template <class Index>
+bool Tester::checkBalancedIndex(const Index& index, uint32_t node, int& height) {
+    if (node == Index::NONE) {
+        height = 0;
+        return true;
+    }
+    int left = 0;
+    int right = 0;
+    uint32_t leftChild = index.m_nodes[node].m_left;
+    uint32_t rightChild = index.m_nodes[node].m_right;
+    if (!checkBalancedIndex(index, leftChild, left) || !checkBalancedIndex(index, rightChild, right)) {
+        return false;
+    }
+    height = std::max(left, right) + 1;
+    if ((leftChild != Index::NONE && !index.m_compare(index.m_nodes[leftChild].m_key, index.m_nodes[node].m_key)) ||
+        (rightChild != Index::NONE && !index.m_compare(index.m_nodes[node].m_key, index.m_nodes[rightChild].m_key))) {
+        return false;
+    }
+    return index.m_nodes[node].m_height == height && std::abs(left - right) <= 1;
+}
+
+// TEST 39: Test BalancedIndex with 16-bit and 32-bit keys, a struct payload and a reversed order against std::map.
+// Random inserts, removes and payload updates on ground stations keyed by
+// 16-bit ID must match a std::map at the end, in full and over ranges, and
+// the tree must stay a valid AVL tree. Debris keyed by 32-bit catalog number
+// in reverse order checks Compare, bulkLoad and duplicates.
+bool Tester::testBalancedIndex(int n) {
+    struct GroundStation{
+        int m_antennas;
+        float m_latitude;
+    };
+    bool passed = true;
+    try {
+        BalancedIndex<uint16_t, GroundStation> stations;
+        std::map<uint16_t, int> expected;
+        Random keyGen(0, 65535);
+        for (int i = 0; i < n; i++) {
+            uint16_t key = (uint16_t)keyGen.getRandNum();
+            if (i % 4 == 3) {
+                if ((stations.tryRemove(key) == SUCCESS) != (expected.erase(key) == 1)) {
+                    passed = false;
+                }
+            } else if (stations.contains(key)) {
+                stations.find(key)->m_antennas++;
+                expected[key]++;
+                if (stations.tryInsert(key, GroundStation()) != DUPLICATE) {
+                    passed = false;
+                }
+            } else {
+                stations.insert(key, GroundStation{i, 0.5f});
+                expected[key] = i;
+            }
+        }
+        int height = 0;
+        if (!passed || stations.size() != (int)expected.size() ||
+            !checkBalancedIndex(stations, stations.m_root, height) || height != stations.height()) {
+            std::cerr << "Error (Test 39): 16-bit index is not a valid AVL tree of the right size" << std::endl;
+            passed = false;
+        }
+        std::vector<std::pair<uint16_t, int> > visited;
+        stations.forEach([&visited](uint16_t key, const GroundStation& station) {
+            visited.push_back(std::make_pair(key, station.m_antennas));
+        });
+        if (visited != std::vector<std::pair<uint16_t, int> >(expected.begin(), expected.end())) {
+            std::cerr << "Error (Test 39): 16-bit index holds the wrong entries" << std::endl;
+            passed = false;
+        }
+        for (int r = 0; passed && r < 50; r++) {
+            uint16_t low = (uint16_t)keyGen.getRandNum();
+            uint16_t high = (uint16_t)std::min(65535, low + r * 300);
+            std::vector<uint16_t> inRange;
+            stations.forEachInRange(low, high, [&inRange](uint16_t key, const GroundStation&) {
+                inRange.push_back(key);
+            });
+            std::vector<uint16_t> wanted;
+            for (std::map<uint16_t, int>::iterator it = expected.lower_bound(low); it != expected.end() && it->first <= high; ++it) {
+                wanted.push_back(it->first);
+            }
+            if (inRange != wanted) {
+                std::cerr << "Error (Test 39): range [" << low << ", " << high << "] is wrong" << std::endl;
+                passed = false;
+            }
+        }
+
+        // debris by catalog number, largest first; bulkLoad keeps the first of repeated keys
+        BalancedIndex<uint32_t, double, std::greater<uint32_t> > debris;
+        std::vector<std::pair<uint32_t, double> > entries;
+        for (uint32_t i = 0; i < 1000; i++) {
+            entries.push_back(std::make_pair(4000000000u - i * 7 % 1000 * 1000, (double)i));
+        }
+        entries.push_back(std::make_pair(4000000000u, -1.0));
+        debris.bulkLoad(entries);
+        uint32_t previous = 0;
+        bool descending = true;
+        int count = 0;
+        debris.forEach([&](uint32_t key, double) {
+            descending = descending && (count == 0 || key < previous);
+            previous = key;
+            count++;
+        });
+        if (!checkBalancedIndex(debris, debris.m_root, height) || !descending || count != 1000 ||
+            debris.size() != 1000 || *debris.find(4000000000u) != 0.0 || debris.find(1) != nullptr) {
+            std::cerr << "Error (Test 39): reversed 32-bit index is wrong after bulkLoad" << std::endl;
+            passed = false;
+        }
+        bool thrown = false;
+        try {
+            debris.insert(4000000000u, 1.0);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        for (uint32_t i = 0; i < 1000; i += 2) {
+            debris.remove(4000000000u - i * 1000);
+        }
+        if (!thrown || debris.size() != 500 || !checkBalancedIndex(debris, debris.m_root, height) ||
+            debris.tryRemove(4000000000u) != NOT_FOUND) {
+            std::cerr << "Error (Test 39): duplicate insert or removal on the reversed index is wrong" << std::endl;
+            passed = false;
+        }
+        debris.clear();
+        if (!debris.empty() || debris.height() != 0 || debris.contains(3999999000u)) {
+            std::cerr << "Error (Test 39): clear left entries behind" << std::endl;
+            passed = false;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 39): " << e.what() << std::endl;
+        passed = false;
+    }
+    return passed;
+}
+
+// TEST 40: Test every ConcurrentSatNet read against structural writers; run it under ThreadSanitizer.
+// n stable MI208 satellites at even IDs stay in the fleet, while one writer
+// inserts MI350 satellites at odd IDs and removes them again, and another
+// marks them DEORBITED and sweeps them out with removeDeorbited. Readers use
+// findSatellite, countSatellites, getCounts and copy, and must always see
+// exactly the stable MI208 satellites and a valid tree. Built with
+// -fsanitize=thread the test must run without a report, since no read of the
+// tree happens outside the lock.
+bool Tester::testConcurrentReadWrite(ConcurrentSatNet &fleet, int n) {
+    try {
+        const int base = 20000;
+        for (int i = 0; i < n; i++) {
+            fleet.insert(Sat(base + 2 * i, MI208));
+        }
+
+        std::atomic<int> errors(0);
+        std::atomic<bool> writing(true);
+        std::thread inserter([&fleet, n]() {
+            for (int round = 0; round < 4; round++) {
+                // some are still there from the round before
+                for (int i = 0; i < n; i++) {
+                    fleet.tryInsert(Sat(base + 2 * i + 1, MI350));
+                }
+                for (int i = round % 2; i < n; i += 2) {
+                    fleet.tryRemove(base + 2 * i + 1);
+                }
+            }
+        });
+        std::thread sweeper([&fleet, &writing]() {
+            while (writing) {
+                for (int i = 0; i < 64; i++) {
+                    fleet.setState(base + 2 * i + 1, DEORBITED);
+                }
+                fleet.removeDeorbited();
+            }
+        });
+
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 2; r++) {
+            readers.push_back(std::thread([this, &fleet, &errors, &writing, n, r]() {
+                int pass = 0;
+                do {
+                    for (int i = r; i < n; i += 2) {
+                        if (!fleet.findSatellite(base + 2 * i)) {
+                            errors++;
+                        }
+                    }
+                    SatCounts counts = fleet.getCounts(base, base + 2 * n);
+                    if (fleet.countSatellites(MI208) != n || counts.m_alt[MI208] != n ||
+                        counts.total() < n || counts.total() > 2 * n) {
+                        errors++;
+                    }
+                    if (pass++ % 8 == r) {
+                        SatNet copy = fleet.copy();
+                        int height = 0;
+                        if (!copy.getBSTValidity(copy.getRoot()) || !checkAVL(copy, copy.getRoot(), height) ||
+                            copy.countSatellites(MI208) != n) {
+                            errors++;
+                        }
+                    }
+                } while (writing);
+            }));
+        }
+
+        inserter.join();
+        writing = false;
+        sweeper.join();
+        for (size_t i = 0; i < readers.size(); i++) {
+            readers[i].join();
+        }
+        if (errors != 0) {
+            std::cerr << "Error (Test 40): " << errors << " inconsistent operations" << std::endl;
+            return false;
+        }
+
+        // a last sweep leaves the stable satellites and the odd ones nobody marked
+        for (int i = 0; i < n; i++) {
+            fleet.setState(base + 2 * i + 1, DEORBITED);
+        }
+        fleet.removeDeorbited();
+        return fleet.getCounts().total() == n && fleet.countSatellites(MI208) == n &&
+               fleet.countSatellites(DEORBITED) == 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error (Test 40): " << e.what() << std::endl;
+        return false;
+    }
+}
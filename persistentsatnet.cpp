@@ -0,0 +1,289 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#include "persistentsatnet.h"
+#include <algorithm>
+#include <stdexcept>
+
+std::atomic<long> PersistentNode::s_live(0);
+
+PersistentNode::PersistentNode(int id, ALT alt, INCLIN inclin, STATE state, PersistentLink left, PersistentLink right)
+        : m_left(std::move(left)), m_right(std::move(right)), m_id(id), m_alt(alt), m_inclin(inclin), m_state(state) {
+    int leftHeight = m_left ? m_left->m_height : 0;
+    int rightHeight = m_right ? m_right->m_height : 0;
+    m_height = 1 + std::max(leftHeight, rightHeight);
+    if (m_left) {
+        m_counts.add(m_left->m_counts);
+    }
+    if (m_right) {
+        m_counts.add(m_right->m_counts);
+    }
+    m_counts.add(state, alt, inclin);
+    s_live.fetch_add(1, std::memory_order_relaxed);
+}
+
+PersistentNode::~PersistentNode(){
+    s_live.fetch_sub(1, std::memory_order_relaxed);
+}
+
+PersistentSatNet::PersistentSatNet(){
+}
+
+PersistentSatNet::PersistentSatNet(const SatNet& satNet){
+    std::vector<Sat> satellites;
+    satNet.flatten(satellites);
+    m_root = buildBalanced(satellites.data(), satellites.data() + satellites.size());
+}
+
+// NODE CONSTRUCTION
+
+PersistentLink PersistentSatNet::rebuild(const PersistentNode& like, PersistentLink left, PersistentLink right) {
+    return std::make_shared<const PersistentNode>(like.m_id, like.m_alt, like.m_inclin, like.m_state,
+                                                  std::move(left), std::move(right));
+}
+
+// The rotations of SatNet::balance, written as construction: the nodes that
+// would have been relinked are built anew around the subtrees that stay put.
+PersistentLink PersistentSatNet::balance(const PersistentNode& like, PersistentLink left, PersistentLink right) {
+    if (height(left) > height(right) + 1) {
+        const PersistentNode& pivot = *left;
+        if (height(pivot.m_left) >= height(pivot.m_right)) {
+            // Left Left Case
+            return rebuild(pivot, pivot.m_left, rebuild(like, pivot.m_right, std::move(right)));
+        }
+        // Left Right Case
+        const PersistentNode& inner = *pivot.m_right;
+        return rebuild(inner, rebuild(pivot, pivot.m_left, inner.m_left),
+                       rebuild(like, inner.m_right, std::move(right)));
+    }
+    if (height(right) > height(left) + 1) {
+        const PersistentNode& pivot = *right;
+        if (height(pivot.m_right) >= height(pivot.m_left)) {
+            // Right Right Case
+            return rebuild(pivot, rebuild(like, std::move(left), pivot.m_left), pivot.m_right);
+        }
+        // Right Left Case
+        const PersistentNode& inner = *pivot.m_left;
+        return rebuild(inner, rebuild(like, std::move(left), inner.m_left),
+                       rebuild(pivot, inner.m_right, pivot.m_right));
+    }
+    return rebuild(like, std::move(left), std::move(right));
+}
+
+// PATH COPYING
+// Recursive, since every level builds its node from the ones below it; the
+// depth is bounded by the tree height, at most 24.
+
+PersistentLink PersistentSatNet::insertCopy(const PersistentLink& node, const Sat& satellite, RESULT& result) {
+    if (!node) {
+        result = SUCCESS;
+        return std::make_shared<const PersistentNode>(satellite.getID(), satellite.getAlt(), satellite.getInclin(),
+                                                      satellite.getState(), nullptr, nullptr);
+    }
+    if (satellite.getID() == node->m_id) {
+        result = DUPLICATE;
+        return node;
+    }
+    if (satellite.getID() < node->m_id) {
+        PersistentLink left = insertCopy(node->m_left, satellite, result);
+        return (result == SUCCESS) ? balance(*node, std::move(left), node->m_right) : node;
+    }
+    PersistentLink right = insertCopy(node->m_right, satellite, result);
+    return (result == SUCCESS) ? balance(*node, node->m_left, std::move(right)) : node;
+}
+
+PersistentLink PersistentSatNet::removeMin(const PersistentLink& node) {
+    if (!node->m_left) {
+        return node->m_right;
+    }
+    return balance(*node, removeMin(node->m_left), node->m_right);
+}
+
+PersistentLink PersistentSatNet::removeCopy(const PersistentLink& node, int id, RESULT& result) {
+    if (!node) {
+        result = NOT_FOUND;
+        return node;
+    }
+    if (id < node->m_id) {
+        PersistentLink left = removeCopy(node->m_left, id, result);
+        return (result == SUCCESS) ? balance(*node, std::move(left), node->m_right) : node;
+    }
+    if (id > node->m_id) {
+        PersistentLink right = removeCopy(node->m_right, id, result);
+        return (result == SUCCESS) ? balance(*node, node->m_left, std::move(right)) : node;
+    }
+
+    result = SUCCESS;
+    if (!node->m_left) {
+        return node->m_right;
+    }
+    if (!node->m_right) {
+        return node->m_left;
+    }
+    // the in-order successor takes this node's place
+    const PersistentNode* successor = node->m_right.get();
+    while (successor->m_left) {
+        successor = successor->m_left.get();
+    }
+    return balance(*successor, node->m_left, removeMin(node->m_right));
+}
+
+// an unchanged state copies nothing
+PersistentLink PersistentSatNet::setStateCopy(const PersistentLink& node, int id, STATE state, bool& found) {
+    if (!node) {
+        found = false;
+        return node;
+    }
+    if (id == node->m_id) {
+        found = true;
+        if (node->m_state == state) {
+            return node;
+        }
+        return std::make_shared<const PersistentNode>(node->m_id, node->m_alt, node->m_inclin, state,
+                                                      node->m_left, node->m_right);
+    }
+    if (id < node->m_id) {
+        PersistentLink left = setStateCopy(node->m_left, id, state, found);
+        return (left != node->m_left) ? rebuild(*node, std::move(left), node->m_right) : node;
+    }
+    PersistentLink right = setStateCopy(node->m_right, id, state, found);
+    return (right != node->m_right) ? rebuild(*node, node->m_left, std::move(right)) : node;
+}
+
+// the middle element becomes the root, as in SatNet::buildBalanced
+PersistentLink PersistentSatNet::buildBalanced(const Sat* first, const Sat* last) {
+    if (first == last) {
+        return nullptr;
+    }
+    const Sat* middle = first + (last - first) / 2;
+    return std::make_shared<const PersistentNode>(middle->getID(), middle->getAlt(), middle->getInclin(),
+                                                  middle->getState(), buildBalanced(first, middle),
+                                                  buildBalanced(middle + 1, last));
+}
+
+// COUNT SATELLITES
+// the same descent as SatNet::countUpTo
+void PersistentSatNet::countUpTo(int maxID, SatCounts& counts) const {
+    const PersistentNode* node = m_root.get();
+    while (node != nullptr) {
+        if (node->m_id <= maxID) {
+            if (node->m_left) {
+                counts.add(node->m_left->m_counts);
+            }
+            counts.add(node->m_state, node->m_alt, node->m_inclin);
+            node = node->m_right.get();
+        } else {
+            node = node->m_left.get();
+        }
+    }
+}
+
+// BASE METHODS
+
+void PersistentSatNet::insert(const Sat& satellite){
+    RESULT result = tryInsert(satellite);
+    if (result == DUPLICATE) {
+        // throw exception
+        throw std::runtime_error("Satellite already exists (ID: " + std::to_string(satellite.getID()) + ")");
+    } else if (result == OUT_OF_RANGE) {
+        // throw exception
+        throw std::runtime_error("Satellite ID out of range (ID: " + std::to_string(satellite.getID()) + ")");
+    }
+}
+
+RESULT PersistentSatNet::tryInsert(const Sat& satellite){
+    if (satellite.getID() < MINID || satellite.getID() > MAXID) {
+        return OUT_OF_RANGE;
+    }
+    RESULT result = SUCCESS;
+    m_root = insertCopy(m_root, satellite, result);
+    return result;
+}
+
+// other versions keep their nodes alive
+void PersistentSatNet::clear(){
+    m_root.reset();
+}
+
+void PersistentSatNet::remove(int id){
+    tryRemove(id);
+}
+
+RESULT PersistentSatNet::tryRemove(int id){
+    if (id < MINID || id > MAXID) {
+        return OUT_OF_RANGE;
+    }
+    RESULT result = SUCCESS;
+    m_root = removeCopy(m_root, id, result);
+    return result;
+}
+
+bool PersistentSatNet::setState(int id, STATE state){
+    bool found = false;
+    m_root = setStateCopy(m_root, id, state, found);
+    return found;
+}
+
+bool PersistentSatNet::findSatellite(int id) const {
+    STATE state = ACTIVE;
+    return getState(id, state);
+}
+
+bool PersistentSatNet::getState(int id, STATE& state) const {
+    const PersistentNode* node = m_root.get();
+    while (node != nullptr) {
+        if (id == node->m_id) {
+            state = node->m_state;
+            return true;
+        }
+        node = (id < node->m_id) ? node->m_left.get() : node->m_right.get();
+    }
+    return false;
+}
+
+int PersistentSatNet::size() const {
+    return m_root ? m_root->m_counts.total() : 0;
+}
+
+int PersistentSatNet::countSatellites(INCLIN degree) const{
+    return m_root ? m_root->m_counts.m_inclin[degree] : 0;
+}
+
+int PersistentSatNet::countSatellites(ALT altitude) const{
+    return m_root ? m_root->m_counts.m_alt[altitude] : 0;
+}
+
+int PersistentSatNet::countSatellites(STATE state) const{
+    return m_root ? m_root->m_counts.m_state[state] : 0;
+}
+
+SatCounts PersistentSatNet::getCounts(int minID, int maxID) const{
+    SatCounts counts;
+    if (minID > maxID) {
+        return counts;
+    }
+    countUpTo(maxID, counts);
+    SatCounts below;
+    countUpTo(minID - 1, below);
+    counts.subtract(below);
+    return counts;
+}
+
+// in-order walk with an explicit stack, then the same balanced build bulkLoad uses
+SatNet PersistentSatNet::toSatNet() const{
+    std::vector<Sat> satellites;
+    satellites.reserve(size());
+    const PersistentNode* stack[SatNet::MAXHEIGHT];
+    int depth = 0;
+    const PersistentNode* node = m_root.get();
+    while (node != nullptr || depth > 0) {
+        while (node != nullptr) {
+            stack[depth++] = node;
+            node = node->m_left.get();
+        }
+        node = stack[--depth];
+        satellites.push_back(Sat(node->m_id, node->m_alt, node->m_inclin, node->m_state));
+        node = node->m_right.get();
+    }
+    SatNet satNet;
+    satNet.bulkLoad(std::move(satellites));
+    return satNet;
+}
@@ -0,0 +1,81 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#ifndef PERSISTENTSATNET_H
+#define PERSISTENTSATNET_H
+#include "satnet.h"
+#include <atomic>
+#include <memory>
+struct PersistentNode;
+typedef std::shared_ptr<const PersistentNode> PersistentLink;
+// A tree node of a PersistentSatNet. Nodes never change once built, so any
+// number of versions can share them; a node goes away with the last version
+// that links to it.
+struct PersistentNode{
+    PersistentLink m_left;  //the left child in the BST
+    PersistentLink m_right; //the right child in the BST
+    SatCounts m_counts;     //totals of the subtree rooted here
+    int m_id;
+    int m_height;           //the height of node in the BST
+    ALT m_alt;
+    INCLIN m_inclin;
+    STATE m_state;
+    PersistentNode(int id, ALT alt, INCLIN inclin, STATE state, PersistentLink left, PersistentLink right);
+    ~PersistentNode();
+    // nodes alive across all versions, for memory accounting
+    static long live() {return s_live.load(std::memory_order_relaxed);}
+private:
+    static std::atomic<long> s_live;
+};
+// A SatNet whose versions share structure. Copying a PersistentSatNet or
+// calling snapshot() is O(1): the copy shares the current root. insert,
+// remove and setState never touch existing nodes; they build new copies of
+// the O(log n) nodes on the path and leave every older version as it was.
+// A version is a value: one thread at a time may change it, while any number
+// of threads read it or other versions.
+class PersistentSatNet{
+public:
+    friend class Grader;
+    friend class Tester;
+    PersistentSatNet();
+    // a first version holding the same fleet, O(n)
+    explicit PersistentSatNet(const SatNet& satNet);
+    // the current version, O(1)
+    PersistentSatNet snapshot() const {return *this;}
+    void insert(const Sat& satellite);
+    RESULT tryInsert(const Sat& satellite);
+    void clear();
+    void remove(int id);
+    RESULT tryRemove(int id);
+    bool setState(int id, STATE state);
+    bool findSatellite(int id) const;
+    // false if the satellite is not in this version
+    bool getState(int id, STATE& state) const;
+    int size() const;
+    int countSatellites(INCLIN degree) const;
+    int countSatellites(ALT altitude) const;
+    int countSatellites(STATE state) const;
+    // all totals for IDs in [minID, maxID], O(log n)
+    SatCounts getCounts(int minID = MINID, int maxID = MAXID) const;
+    // a mutable SatNet holding this version, O(n)
+    SatNet toSatNet() const;
+
+private:
+    PersistentLink m_root;  //the root of the BST
+
+    static int height(const PersistentLink& node) {return node ? node->m_height : 0;}
+    // a new node with the attributes of like and the given children
+    static PersistentLink rebuild(const PersistentNode& like, PersistentLink left, PersistentLink right);
+    // rebuild, with a single or double rotation if the children differ in height by two
+    static PersistentLink balance(const PersistentNode& like, PersistentLink left, PersistentLink right);
+
+    // path copying; each returns the new subtree, or node itself if nothing changed
+    static PersistentLink insertCopy(const PersistentLink& node, const Sat& satellite, RESULT& result);
+    static PersistentLink removeCopy(const PersistentLink& node, int id, RESULT& result);
+    static PersistentLink removeMin(const PersistentLink& node);
+    static PersistentLink setStateCopy(const PersistentLink& node, int id, STATE state, bool& found);
+
+    // builds a balanced subtree from the sorted range [first, last)
+    static PersistentLink buildBalanced(const Sat* first, const Sat* last);
+    // adds the totals of every node with ID <= maxID to counts
+    void countUpTo(int maxID, SatCounts& counts) const;
+};
+#endif
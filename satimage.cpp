@@ -0,0 +1,209 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#include "satimage.h"
+#include "satwriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint32_t SatImage::VERSION;
+
+namespace {
+const char MAGIC[8] = {'S', 'A', 'T', 'I', 'M', 'G', '\r', '\n'};
+
+std::runtime_error imageError(const std::string& path, const std::string& what) {
+    return std::runtime_error("Snapshot " + path + ": " + what);
+}
+
+// a rename is only durable once the directory holding the file is synced
+void syncDirectory(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string directory = (slash == std::string::npos) ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        throw imageError(path, std::strerror(errno));
+    }
+    if (fsync(fd) != 0) {
+        int error = errno;
+        close(fd);
+        throw imageError(path, std::strerror(error));
+    }
+    close(fd);
+}
+}
+
+SatImage::SatImage(const std::string& path) : m_map(nullptr), m_length(0), m_records(nullptr), m_count(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw imageError(path, std::strerror(errno));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        int error = errno;
+        close(fd);
+        throw imageError(path, std::strerror(error));
+    }
+    m_length = (size_t)info.st_size;
+    if (m_length < sizeof(Header)) {
+        close(fd);
+        throw imageError(path, "too short for a header");
+    }
+    m_map = mmap(nullptr, m_length, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    // the mapping keeps the file alive on its own
+    close(fd);
+    if (m_map == MAP_FAILED) {
+        m_map = nullptr;
+        throw imageError(path, std::strerror(error));
+    }
+    try {
+        validate(path);
+    } catch (...) {
+        munmap(m_map, m_length);
+        throw;
+    }
+    m_count = ((const Header*)m_map)->m_count;
+    m_records = (const uint32_t*)((const char*)m_map + sizeof(Header));
+}
+
+SatImage::~SatImage(){
+    if (m_map != nullptr) {
+        munmap(m_map, m_length);
+    }
+}
+
+// every record is checked, so nothing read from the file later can be out of range
+void SatImage::validate(const std::string& path) const {
+    const Header& header = *(const Header*)m_map;
+    if (std::memcmp(header.m_magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw imageError(path, "not a satellite snapshot");
+    }
+    if (header.m_version != VERSION) {
+        throw imageError(path, "unsupported format version " + std::to_string(header.m_version));
+    }
+    if (m_length != sizeof(Header) + (size_t)header.m_count * sizeof(uint32_t)) {
+        throw imageError(path, "length does not match the satellite count");
+    }
+    const uint32_t* records = (const uint32_t*)((const char*)m_map + sizeof(Header));
+    if (checksum(records, header.m_count) != header.m_checksum) {
+        throw imageError(path, "checksum mismatch");
+    }
+    int previous = MINID - 1;
+    for (uint32_t i = 0; i < header.m_count; i++) {
+        int id = recordID(records[i]);
+        if (id <= previous || id > MAXID || ((records[i] >> 21) & 3) >= NUMSTATES || (records[i] >> 23) != 0) {
+            throw imageError(path, "bad record " + std::to_string(i));
+        }
+        previous = id;
+    }
+}
+
+// RECORDS
+uint32_t SatImage::pack(const Sat& satellite){
+    return (uint32_t)satellite.getID() | (uint32_t)satellite.getAlt() << 17 | (uint32_t)satellite.getInclin() << 19 |
+           (uint32_t)satellite.getState() << 21;
+}
+
+Sat SatImage::unpack(uint32_t record){
+    return Sat(recordID(record), (ALT)((record >> 17) & 3), (INCLIN)((record >> 19) & 3), (STATE)((record >> 21) & 3));
+}
+
+uint64_t SatImage::checksum(const uint32_t* records, size_t count){
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < count; i++) {
+        hash ^= records[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// QUERIES
+uint64_t SatImage::getChecksum() const {
+    return ((const Header*)m_map)->m_checksum;
+}
+
+int SatImage::find(int id) const {
+    const uint32_t* end = m_records + m_count;
+    const uint32_t* at = std::lower_bound(m_records, end, id, [](uint32_t record, int key) {
+        return recordID(record) < key;
+    });
+    return (at != end && recordID(*at) == id) ? (int)(at - m_records) : -1;
+}
+
+bool SatImage::findSatellite(int id) const {
+    return find(id) >= 0;
+}
+
+bool SatImage::getState(int id, STATE& state) const {
+    int i = find(id);
+    if (i < 0) {
+        return false;
+    }
+    state = (STATE)((m_records[i] >> 21) & 3);
+    return true;
+}
+
+Sat SatImage::satellite(int i) const {
+    return unpack(m_records[i]);
+}
+
+void SatImage::satellites(std::vector<Sat>& sorted) const {
+    sorted.reserve(sorted.size() + m_count);
+    for (uint32_t i = 0; i < m_count; i++) {
+        sorted.push_back(unpack(m_records[i]));
+    }
+}
+
+// SAVING
+uint64_t SatImage::checksum(const std::vector<Sat>& sorted){
+    std::vector<uint32_t> records(sorted.size());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        records[i] = pack(sorted[i]);
+    }
+    return checksum(records.data(), records.size());
+}
+
+void SatImage::save(const std::string& path, const std::vector<Sat>& sorted){
+    std::vector<uint32_t> records(sorted.size());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        records[i] = pack(sorted[i]);
+    }
+    Header header;
+    std::memcpy(header.m_magic, MAGIC, sizeof(MAGIC));
+    header.m_version = VERSION;
+    header.m_count = (uint32_t)records.size();
+    header.m_checksum = checksum(records.data(), records.size());
+
+    std::string temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw imageError(temporary, std::strerror(errno));
+    }
+    try {
+        SatWriter out(fd);
+        out.write((const char*)&header, sizeof(header));
+        // an empty fleet has no records, and records.data() may be null
+        if (!records.empty()) {
+            out.write((const char*)records.data(), records.size() * sizeof(uint32_t));
+        }
+        out.flush();
+        if (fsync(fd) != 0) {
+            throw imageError(temporary, std::strerror(errno));
+        }
+    } catch (...) {
+        close(fd);
+        unlink(temporary.c_str());
+        throw;
+    }
+    close(fd);
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        int error = errno;
+        unlink(temporary.c_str());
+        throw imageError(path, std::strerror(error));
+    }
+    syncDirectory(path);
+}
@@ -0,0 +1,66 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#ifndef SATIMAGE_H
+#define SATIMAGE_H
+#include "satnet.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+// A fleet saved to disk by SatNet::saveSnapshot, mapped read-only with mmap.
+// The file is a 24-byte header (magic, format version, satellite count and a
+// checksum of the records) followed by one 4-byte record per satellite in
+// increasing ID order: the ID in bits 0-16, altitude in 17-18, inclination in
+// 19-20 and state in 21-22, so a full fleet is about 360 KB. Opening a file
+// checks all of it; lookups then run in place by binary search, and
+// SatNet::loadSnapshot builds a balanced tree from the sorted records in
+// O(n). Records are stored in host byte order.
+class SatImage{
+public:
+    friend class Grader;
+    friend class Tester;
+    // throws std::runtime_error if path cannot be read or is not a valid image
+    explicit SatImage(const std::string& path);
+    SatImage(const SatImage& rhs) = delete;
+    SatImage& operator=(const SatImage& rhs) = delete;
+    ~SatImage();
+    int size() const {return (int)m_count;}
+    // the checksum stored in the header, which identifies this fleet
+    uint64_t getChecksum() const;
+    bool findSatellite(int id) const;
+    // false if the satellite is not in the image
+    bool getState(int id, STATE& state) const;
+    // the i-th satellite in ID order
+    Sat satellite(int i) const;
+    // appends every satellite in ID order
+    void satellites(std::vector<Sat>& sorted) const;
+    // the getChecksum() of the file save() writes for the sorted satellites
+    static uint64_t checksum(const std::vector<Sat>& sorted);
+    // writes the sorted satellites to a temporary file next to path, syncs
+    // it, renames it over path and syncs the directory, so a crash leaves the
+    // old file or the new one but never half of one
+    static void save(const std::string& path, const std::vector<Sat>& sorted);
+
+private:
+    static const uint32_t VERSION = 1;
+    struct Header{
+        char m_magic[8];        // "SATIMG\r\n"
+        uint32_t m_version;     // VERSION; a file from a host of the other byte order fails here too
+        uint32_t m_count;       // records after the header
+        uint64_t m_checksum;    // checksum() of the records
+    };
+    void* m_map;                // the whole file
+    size_t m_length;
+    const uint32_t* m_records;  // m_count records right after the header
+    uint32_t m_count;
+
+    static uint32_t pack(const Sat& satellite);
+    static int recordID(uint32_t record) {return (int)(record & 0x1FFFF);}
+    static Sat unpack(uint32_t record);
+    // FNV-1a over the 32-bit records
+    static uint64_t checksum(const uint32_t* records, size_t count);
+    // the index of the record holding id, or -1
+    int find(int id) const;
+    // throws if the mapped file is not a valid image
+    void validate(const std::string& path) const;
+};
+#endif
@@ -0,0 +1,387 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#include "satingest.h"
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+const size_t SatIngestReport::MAXBADLINES;
+const int SatIngest::QUEUEDEPTH;
+
+namespace {
+std::runtime_error catalogError(const std::string& path, const std::string& what) {
+    return std::runtime_error("Catalog " + path + ": " + what);
+}
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// trims spaces (and the \r of a CRLF line) off both ends of [begin, end)
+void trim(const char*& begin, const char*& end) {
+    while (begin < end && isSpace(*begin)) {
+        begin++;
+    }
+    while (end > begin && isSpace(end[-1])) {
+        end--;
+    }
+}
+
+// [begin, end) equals word, ignoring case; word is lower case
+bool equals(const char* begin, const char* end, const char* word) {
+    for (; begin < end; begin++, word++) {
+        if (*word == '\0' || (*begin | 0x20) != *word) {
+            return false;
+        }
+    }
+    return *word == '\0';
+}
+
+// at most 9 digits, so the value fits an int; -1 otherwise
+int number(const char* begin, const char* end) {
+    if (begin == end || end - begin > 9) {
+        return -1;
+    }
+    int value = 0;
+    for (; begin < end; begin++) {
+        unsigned digit = (unsigned)(*begin - '0');
+        if (digit > 9) {
+            return -1;
+        }
+        value = value * 10 + (int)digit;
+    }
+    return value;
+}
+
+// the index of value in values, or -1; an optional prefix (MI, I) is skipped
+int lookup(const char* begin, const char* end, const char* prefix, const int* values, int count) {
+    size_t length = std::strlen(prefix);
+    if ((size_t)(end - begin) > length && equals(begin, begin + length, prefix)) {
+        begin += length;
+    }
+    int value = number(begin, end);
+    for (int i = 0; i < count; i++) {
+        if (values[i] == value) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const int ALTITUDES[] = {208, 215, 340, 350};
+const int INCLINATIONS[] = {48, 53, 70, 97};
+const char* const STATES[] = {"active", "deorbited", "decaying"};
+}
+
+SatIngest::SatIngest(int batchSize, size_t chunkSize)
+        : m_batchSize(batchSize < 1 ? 1 : batchSize), m_chunkSize(chunkSize < 1 ? 1 : chunkSize),
+          m_finished(false), m_cancelled(false), m_sawFirstLine(false) {}
+
+SatIngestReport SatIngest::load(const std::string& path, SatNet& satNet){
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw catalogError(path, std::strerror(errno));
+    }
+    SatIngestReport report;
+    try {
+        report = load(fd, satNet);
+    } catch (const std::runtime_error& error) {
+        close(fd);
+        throw catalogError(path, error.what());
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    return report;
+}
+
+SatIngestReport SatIngest::load(int fd, SatNet& satNet){
+    m_queue.clear();
+    m_finished = false;
+    m_cancelled = false;
+    m_error = nullptr;
+    m_columns.clear();
+    m_columns.push_back(IDCOLUMN);
+    m_columns.push_back(ALTCOLUMN);
+    m_columns.push_back(INCLINCOLUMN);
+    m_columns.push_back(STATECOLUMN);
+    m_parsed = SatIngestReport();
+    m_sawFirstLine = false;
+
+    SatIngestReport report;
+    std::thread reader(&SatIngest::readAll, this, fd);
+    try {
+        std::vector<Sat> batch;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_changed.wait(lock, [this] {return !m_queue.empty() || m_finished;});
+                if (m_queue.empty()) {
+                    break;
+                }
+                batch.swap(m_queue.front());
+                m_queue.pop_front();
+            }
+            m_changed.notify_all();
+            insertBatch(batch, satNet, report);
+        }
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cancelled = true;
+        }
+        m_changed.notify_all();
+        reader.join();
+        throw;
+    }
+    reader.join();
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+    report.m_lines = m_parsed.m_lines;
+    report.m_outOfRange = m_parsed.m_outOfRange;
+    report.m_malformed = m_parsed.m_malformed;
+    report.m_badLines.swap(m_parsed.m_badLines);
+    return report;
+}
+
+// READER
+// reads chunk after chunk into one buffer; the unfinished last line of a
+// chunk moves to the front before the next read, so lines are parsed where
+// they were read and nothing is copied but that tail
+void SatIngest::readAll(int fd){
+    try {
+        std::unique_ptr<char[]> buffer;
+        size_t capacity = 0;
+        size_t carried = 0;     // bytes of an unfinished line at the front of the buffer
+        std::vector<Sat> batch;
+        batch.reserve(m_batchSize);
+        for (;;) {
+            if (capacity < carried + m_chunkSize) {
+                // a line longer than a chunk grows the buffer
+                size_t grown = carried + m_chunkSize;
+                std::unique_ptr<char[]> larger(new char[grown]);
+                if (carried > 0) {
+                    std::memcpy(larger.get(), buffer.get(), carried);
+                }
+                buffer.swap(larger);
+                capacity = grown;
+            }
+            ssize_t got = read(fd, buffer.get() + carried, m_chunkSize);
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::strerror(errno));
+            }
+            const char* start = buffer.get();
+            const char* end = start + carried + got;
+            if (got == 0) {
+                // the last line may lack its newline
+                if (start < end) {
+                    parseLine(start, end, batch);
+                }
+                break;
+            }
+            for (;;) {
+                const char* newline = (const char*)std::memchr(start, '\n', end - start);
+                if (newline == nullptr) {
+                    break;
+                }
+                parseLine(start, newline, batch);
+                start = newline + 1;
+                if (batch.size() >= (size_t)m_batchSize && !push(batch)) {
+                    return;
+                }
+            }
+            carried = end - start;
+            std::memmove(buffer.get(), start, carried);
+        }
+        if (!batch.empty()) {
+            push(batch);
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = std::current_exception();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finished = true;
+    }
+    m_changed.notify_all();
+}
+
+bool SatIngest::push(std::vector<Sat>& batch){
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [this] {return m_queue.size() < (size_t)QUEUEDEPTH || m_cancelled;});
+        if (m_cancelled) {
+            return false;
+        }
+        m_queue.push_back(std::vector<Sat>());
+        m_queue.back().swap(batch);
+    }
+    m_changed.notify_all();
+    batch.reserve(m_batchSize);
+    return true;
+}
+
+// PARSING
+void SatIngest::parseLine(const char* begin, const char* end, std::vector<Sat>& batch){
+    m_parsed.m_lines++;
+    trim(begin, end);
+    if (begin == end || *begin == '#') {
+        return;
+    }
+    if (!m_sawFirstLine) {
+        m_sawFirstLine = true;
+        if (isHeader(begin, end)) {
+            parseHeader(begin, end);
+            return;
+        }
+    }
+
+    int id = -1;
+    int alt = -1;
+    int inclin = -1;
+    int state = -1;
+    const char* field = begin;
+    bool more = true;
+    for (size_t column = 0; column < m_columns.size(); column++) {
+        if (!more) {
+            badLine(false);    // too few fields
+            return;
+        }
+        const char* comma = (const char*)std::memchr(field, ',', end - field);
+        const char* fieldEnd = comma == nullptr ? end : comma;
+        const char* first = field;
+        const char* last = fieldEnd;
+        trim(first, last);
+        switch (m_columns[column]) {
+        case IDCOLUMN:
+            id = number(first, last);
+            break;
+        case ALTCOLUMN:
+            alt = lookup(first, last, "mi", ALTITUDES, NUMALTS);
+            break;
+        case INCLINCOLUMN:
+            inclin = lookup(first, last, "i", INCLINATIONS, NUMINCLINS);
+            break;
+        case STATECOLUMN:
+            for (int s = 0; s < NUMSTATES; s++) {
+                if (equals(first, last, STATES[s])) {
+                    state = s;
+                }
+            }
+            break;
+        case SKIPCOLUMN:
+            break;
+        }
+        more = comma != nullptr;
+        field = fieldEnd + 1;
+    }
+    if (more || id < 0 || alt < 0 || inclin < 0 || state < 0) {
+        badLine(false);    // too many fields, or one that does not parse
+    } else if (id < MINID || id > MAXID) {
+        badLine(true);
+    } else {
+        batch.push_back(Sat(id, (ALT)alt, (INCLIN)inclin, (STATE)state));
+    }
+}
+
+// a header names its columns, and the ID column must be one of them; any
+// other first line is a satellite, or a bad line like any other
+bool SatIngest::isHeader(const char* begin, const char* end){
+    const char* field = begin;
+    for (;;) {
+        const char* comma = (const char*)std::memchr(field, ',', end - field);
+        const char* fieldEnd = comma == nullptr ? end : comma;
+        const char* first = field;
+        const char* last = fieldEnd;
+        trim(first, last);
+        if (equals(first, last, "id")) {
+            return true;
+        }
+        if (comma == nullptr) {
+            return false;
+        }
+        field = fieldEnd + 1;
+    }
+}
+
+void SatIngest::parseHeader(const char* begin, const char* end){
+    m_columns.clear();
+    int seen[SKIPCOLUMN] = {0, 0, 0, 0};
+    const char* field = begin;
+    bool more = true;
+    while (more) {
+        const char* comma = (const char*)std::memchr(field, ',', end - field);
+        const char* fieldEnd = comma == nullptr ? end : comma;
+        const char* first = field;
+        const char* last = fieldEnd;
+        trim(first, last);
+        COLUMN column = SKIPCOLUMN;
+        if (equals(first, last, "id")) {
+            column = IDCOLUMN;
+        } else if (equals(first, last, "altitude") || equals(first, last, "alt")) {
+            column = ALTCOLUMN;
+        } else if (equals(first, last, "inclination") || equals(first, last, "inclin")) {
+            column = INCLINCOLUMN;
+        } else if (equals(first, last, "state")) {
+            column = STATECOLUMN;
+        }
+        if (column != SKIPCOLUMN && seen[column]++ > 0) {
+            column = SKIPCOLUMN;    // a repeated column is ignored
+        }
+        m_columns.push_back(column);
+        more = comma != nullptr;
+        field = fieldEnd + 1;
+    }
+    const char* const names[SKIPCOLUMN] = {"id", "altitude", "inclination", "state"};
+    for (int c = 0; c < SKIPCOLUMN; c++) {
+        if (seen[c] == 0) {
+            throw std::runtime_error("the header has no " + std::string(names[c]) + " column");
+        }
+    }
+}
+
+void SatIngest::badLine(bool outOfRange){
+    if (outOfRange) {
+        m_parsed.m_outOfRange++;
+    } else {
+        m_parsed.m_malformed++;
+    }
+    if (m_parsed.m_badLines.size() < SatIngestReport::MAXBADLINES) {
+        m_parsed.m_badLines.push_back(m_parsed.m_lines);
+    }
+}
+
+// INSERTION
+void SatIngest::insertBatch(std::vector<Sat>& batch, SatNet& satNet, SatIngestReport& report){
+    // the fleet's ID bitmap answers "already loaded?" in O(1), without a
+    // descent, and marking each new ID catches repeats within the batch
+    SatIdSet present = satNet.getIDs();
+    size_t fresh = 0;
+    for (size_t i = 0; i < batch.size(); i++) {
+        int id = batch[i].getID();
+        if (!present.contains(id)) {
+            present.insert(id);
+            batch[fresh++] = batch[i];
+        }
+    }
+    report.m_duplicates += (long)(batch.size() - fresh);
+    batch.resize(fresh);
+
+    if (satNet.shouldRebuild(fresh)) {
+        report.m_loaded += satNet.bulkMerge(batch).m_loaded;
+    } else {
+        for (size_t i = 0; i < batch.size(); i++) {
+            satNet.tryInsert(batch[i]);
+        }
+        report.m_loaded += (int)fresh;
+    }
+}
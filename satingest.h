@@ -0,0 +1,81 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#ifndef SATINGEST_H
+#define SATINGEST_H
+#include "satnet.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <vector>
+// Outcome of SatIngest::load
+struct SatIngestReport{
+    long m_lines;               // lines read, blank lines and comments included
+    int m_loaded;               // satellites added to the tree
+    long m_duplicates;          // IDs already in the tree or earlier in the catalog
+    long m_outOfRange;          // IDs outside [MINID, MAXID]
+    long m_malformed;           // lines that are not a satellite
+    std::vector<long> m_badLines;   // the first MAXBADLINES out-of-range or malformed lines, numbered from 1
+    static const size_t MAXBADLINES = 100;
+    SatIngestReport() : m_lines(0), m_loaded(0), m_duplicates(0), m_outOfRange(0), m_malformed(0) {}
+};
+// Streams a satellite catalog into a SatNet. A catalog has one satellite per
+// line with comma-separated fields: ID, altitude, inclination and state, in
+// that order unless the first line is a header naming the columns (id,
+// altitude or alt, inclination or inclin, state; others are skipped), as
+// listSatellites(out, CSV) writes. A first line is a header if one of its
+// fields is id; otherwise it is read as a satellite. Altitudes are 208,
+// 215, 340 or 350 (or MI208 ...), inclinations 48, 53, 70 or 97 (or I48
+// ...), states Active, Deorbited or Decaying in any case. Blank lines and
+// lines starting with # are skipped.
+//
+// A reader thread reads the file in chunks and parses the lines in place, a
+// field at a time, into batches; the calling thread meanwhile adds the
+// previous batch to the tree, so parsing and insertion overlap. Satellites
+// already in the tree are skipped by the fleet's ID bitmap rather than a
+// descent each, and a batch that is large next to the tree goes in with one
+// bulkMerge. As with insert, the first satellite with an ID wins.
+class SatIngest{
+public:
+    friend class Grader;
+    friend class Tester;
+    explicit SatIngest(int batchSize = 65536, size_t chunkSize = 1 << 20);
+    // throws std::runtime_error if the file cannot be read or its header
+    // lacks a column; the satellites of earlier batches stay in the tree
+    SatIngestReport load(const std::string& path, SatNet& satNet);
+    // the same for an open file descriptor, read to its end
+    SatIngestReport load(int fd, SatNet& satNet);
+
+private:
+    enum COLUMN {IDCOLUMN, ALTCOLUMN, INCLINCOLUMN, STATECOLUMN, SKIPCOLUMN};
+    static const int QUEUEDEPTH = 4;    // parsed batches waiting for the tree, at most
+
+    int m_batchSize;
+    size_t m_chunkSize;
+
+    // shared by the reader thread and the caller during a load
+    std::mutex m_mutex;
+    std::condition_variable m_changed;  // a batch was queued or taken, or a side stopped
+    std::deque<std::vector<Sat> > m_queue;
+    bool m_finished;                    // the reader queued its last batch
+    bool m_cancelled;                   // the caller gave up; the reader should stop
+    std::exception_ptr m_error;         // what stopped the reader early
+
+    // owned by the reader thread until it finishes
+    std::vector<COLUMN> m_columns;
+    SatIngestReport m_parsed;           // the line counts
+    bool m_sawFirstLine;
+
+    void readAll(int fd);
+    // parses the complete line [begin, end), without the newline
+    void parseLine(const char* begin, const char* end, std::vector<Sat>& batch);
+    static bool isHeader(const char* begin, const char* end);
+    void parseHeader(const char* begin, const char* end);
+    // false if the caller cancelled
+    bool push(std::vector<Sat>& batch);
+    // adds a batch to the tree and counts what happened to it
+    static void insertBatch(std::vector<Sat>& batch, SatNet& satNet, SatIngestReport& report);
+    void badLine(bool outOfRange);
+};
+#endif
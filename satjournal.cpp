@@ -0,0 +1,457 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#include "satjournal.h"
+#include "satimage.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+const uint32_t SatJournal::VERSION;
+
+namespace {
+const char MAGIC[8] = {'S', 'A', 'T', 'L', 'O', 'G', '\r', '\n'};
+
+std::runtime_error journalError(const std::string& path, const std::string& what) {
+    return std::runtime_error("Journal " + path + ": " + what);
+}
+}
+
+SatJournal::SatJournal(const std::string& path, uint64_t base)
+        : m_path(path), m_fd(-1), m_base(base), m_logged(0), m_durable(0), m_syncing(false), m_failed(false) {
+    std::vector<char> bytes;
+    std::vector<uint32_t> records;
+    size_t end = 0;
+    // a log shorter than its header holds no changes; it was cut short while it was started
+    bool fresh = !readFile(path, bytes) || bytes.size() < sizeof(Header);
+    Header header;
+    if (!fresh) {
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (std::memcmp(header.m_magic, MAGIC, sizeof(MAGIC)) != 0 || header.m_version != VERSION) {
+            throw journalError(path, "not a journal of version " + std::to_string(VERSION));
+        }
+        if (header.m_base == base) {
+            readGroups(bytes, base, records, end);
+        } else if (header.m_checkpointing != 0 && header.m_next == base) {
+            // the snapshot underneath is the checkpoint that took in every change here
+            fresh = true;
+        } else {
+            throw journalError(path, "written on top of snapshot " + std::to_string(header.m_base) +
+                                     ", not " + std::to_string(base) + "; refusing to discard it");
+        }
+    }
+
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_fd < 0) {
+        throw journalError(path, std::strerror(errno));
+    }
+    try {
+        if (fresh) {
+            start(base);
+        } else if (end < bytes.size()) {
+            // a torn last group: cut it off so new groups follow the intact ones
+            if (ftruncate(m_fd, (off_t)end) != 0 || fdatasync(m_fd) != 0) {
+                throw journalError(path, std::strerror(errno));
+            }
+        }
+        if (lseek(m_fd, 0, SEEK_END) < 0) {
+            throw journalError(path, std::strerror(errno));
+        }
+    } catch (...) {
+        close(m_fd);
+        throw;
+    }
+}
+
+SatJournal::~SatJournal(){
+    try {
+        commit();
+    } catch (const std::exception&) {
+        // a destructor must not throw; call commit() first to see the error
+    }
+    close(m_fd);
+}
+
+// RECORDS
+uint32_t SatJournal::pack(OPERATION operation, int id, ALT alt, INCLIN inclin, STATE state){
+    return (uint32_t)operation << 30 | (uint32_t)id | (uint32_t)alt << 17 | (uint32_t)inclin << 19 |
+           (uint32_t)state << 21;
+}
+
+uint32_t SatJournal::check(const uint32_t* records, size_t count){
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < count; i++) {
+        hash ^= records[i];
+        hash *= 1099511628211ULL;
+    }
+    return (uint32_t)hash;
+}
+
+void SatJournal::append(uint32_t record){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_failed) {
+        throw journalError(m_path, "an earlier write failed");
+    }
+    m_pending.push_back(record);
+    m_logged++;
+}
+
+void SatJournal::logInsert(const Sat& satellite){
+    append(pack(INSERT, satellite.getID(), satellite.getAlt(), satellite.getInclin(), satellite.getState()));
+}
+
+void SatJournal::logRemove(int id){
+    append(pack(REMOVE, id, DEFAULT_ALT, DEFAULT_INCLIN, DEFAULT_STATE));
+}
+
+void SatJournal::logSetState(int id, STATE state){
+    append(pack(SETSTATE, id, DEFAULT_ALT, DEFAULT_INCLIN, state));
+}
+
+void SatJournal::logRemoveDeorbited(){
+    append(pack(REMOVEDEORBITED, 0, DEFAULT_ALT, DEFAULT_INCLIN, DEFAULT_STATE));
+}
+
+int SatJournal::pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (int)(m_logged - m_durable);
+}
+
+// GROUP COMMIT
+// The first thread to find no sync running takes every pending record and
+// writes them as one group; the others wait for it and, if their records
+// were logged after it started, one of them writes the next group.
+void SatJournal::commit(){
+    std::unique_lock<std::mutex> lock(m_mutex);
+    uint64_t target = m_logged;
+    while (m_durable < target) {
+        if (m_failed) {
+            throw journalError(m_path, "an earlier write failed");
+        }
+        if (m_syncing) {
+            m_synced.wait(lock);
+            continue;
+        }
+        m_syncing = true;
+        std::vector<uint32_t> group;
+        group.swap(m_pending);
+        uint64_t upTo = m_logged;
+        lock.unlock();
+        try {
+            writeGroup(group);
+        } catch (...) {
+            lock.lock();
+            m_syncing = false;
+            m_failed = true;
+            m_synced.notify_all();
+            throw;
+        }
+        lock.lock();
+        m_syncing = false;
+        m_durable = upTo;
+        m_synced.notify_all();
+    }
+}
+
+void SatJournal::writeGroup(const std::vector<uint32_t>& records){
+    GroupHeader header;
+    header.m_count = (uint32_t)records.size();
+    header.m_check = check(records.data(), records.size());
+    std::vector<char> bytes(sizeof(header) + records.size() * sizeof(uint32_t));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + sizeof(header), records.data(), records.size() * sizeof(uint32_t));
+
+    const char* data = bytes.data();
+    size_t size = bytes.size();
+    while (size > 0) {
+        ssize_t written = write(m_fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw journalError(m_path, std::strerror(errno));
+        }
+        data += written;
+        size -= written;
+    }
+    if (fdatasync(m_fd) != 0) {
+        throw journalError(m_path, std::strerror(errno));
+    }
+}
+
+// STARTING AFRESH
+void SatJournal::start(uint64_t base){
+    if (ftruncate(m_fd, 0) != 0) {
+        throw journalError(m_path, std::strerror(errno));
+    }
+    m_base = base;
+    writeHeader(false, 0);
+    if (lseek(m_fd, 0, SEEK_END) < 0) {
+        throw journalError(m_path, std::strerror(errno));
+    }
+}
+
+void SatJournal::writeHeader(bool checkpointing, uint64_t next){
+    Header header;
+    std::memcpy(header.m_magic, MAGIC, sizeof(MAGIC));
+    header.m_version = VERSION;
+    header.m_checkpointing = checkpointing ? 1 : 0;
+    header.m_base = m_base;
+    header.m_next = next;
+    if (pwrite(m_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) || fdatasync(m_fd) != 0) {
+        throw journalError(m_path, std::strerror(errno));
+    }
+}
+
+void SatJournal::prepare(uint64_t next){
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_synced.wait(lock, [this]() {
+        return !m_syncing;
+    });
+    if (m_failed) {
+        throw journalError(m_path, "an earlier write failed");
+    }
+    try {
+        writeHeader(true, next);
+    } catch (...) {
+        m_failed = true;
+        throw;
+    }
+}
+
+void SatJournal::abandon(){
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_synced.wait(lock, [this]() {
+        return !m_syncing;
+    });
+    m_failed = true;
+}
+
+// the changes still pending are in the snapshot already, so they are dropped
+void SatJournal::reset(uint64_t base){
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_synced.wait(lock, [this]() {
+        return !m_syncing;
+    });
+    m_pending.clear();
+    m_durable = m_logged;
+    try {
+        start(base);
+        m_failed = false;
+    } catch (...) {
+        m_failed = true;
+        throw;
+    }
+}
+
+// REPLAY
+
+bool SatJournal::readFile(const std::string& path, std::vector<char>& bytes){
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// false if the header is missing, damaged or names another snapshot
+bool SatJournal::readGroups(const std::vector<char>& bytes, uint64_t base, std::vector<uint32_t>& records, size_t& end){
+    Header header;
+    if (bytes.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.m_magic, MAGIC, sizeof(MAGIC)) != 0 || header.m_version != VERSION || header.m_base != base) {
+        return false;
+    }
+    end = sizeof(header);
+    while (bytes.size() - end >= sizeof(GroupHeader)) {
+        GroupHeader group;
+        std::memcpy(&group, bytes.data() + end, sizeof(group));
+        size_t size = (size_t)group.m_count * sizeof(uint32_t);
+        if (bytes.size() - end - sizeof(group) < size) {
+            break;
+        }
+        std::vector<uint32_t> chunk(group.m_count);
+        std::memcpy(chunk.data(), bytes.data() + end + sizeof(group), size);
+        if (check(chunk.data(), chunk.size()) != group.m_check) {
+            break;
+        }
+        bool valid = true;
+        for (size_t i = 0; i < chunk.size() && valid; i++) {
+            int id = chunk[i] & 0x1FFFF;
+            OPERATION operation = (OPERATION)(chunk[i] >> 30);
+            valid = ((chunk[i] >> 21) & 3) < (uint32_t)NUMSTATES && ((chunk[i] >> 23) & 0x7F) == 0 &&
+                    (operation == REMOVEDEORBITED || (id >= MINID && id <= MAXID));
+        }
+        if (!valid) {
+            break;
+        }
+        records.insert(records.end(), chunk.begin(), chunk.end());
+        end += sizeof(group) + size;
+    }
+    return true;
+}
+
+// Replaying the records one call at a time would give the same fleet; runs
+// of one operation go through the batch paths instead. A large run of inserts
+// is a bulkMerge, which keeps the tree's copy and the first of repeated IDs
+// just as tryInsert would; a large run of removals is one removeIf.
+int SatJournal::replay(const std::string& path, uint64_t base, SatNet& satNet){
+    std::vector<char> bytes;
+    std::vector<uint32_t> records;
+    size_t end = 0;
+    if (!readFile(path, bytes) || !readGroups(bytes, base, records, end)) {
+        return 0;
+    }
+
+    size_t i = 0;
+    while (i < records.size()) {
+        OPERATION operation = (OPERATION)(records[i] >> 30);
+        size_t last = i;
+        while (last < records.size() && (OPERATION)(records[last] >> 30) == operation) {
+            last++;
+        }
+        size_t run = last - i;
+        bool rebuild = satNet.shouldRebuild(run);
+        if (operation == INSERT) {
+            std::vector<Sat> batch;
+            for (size_t r = i; r < last; r++) {
+                uint32_t record = records[r];
+                batch.push_back(Sat(record & 0x1FFFF, (ALT)((record >> 17) & 3), (INCLIN)((record >> 19) & 3),
+                                    (STATE)((record >> 21) & 3)));
+            }
+            if (rebuild) {
+                satNet.bulkMerge(batch);
+            } else {
+                for (size_t b = 0; b < batch.size(); b++) {
+                    satNet.tryInsert(batch[b]);
+                }
+            }
+        } else if (operation == REMOVE) {
+            if (rebuild) {
+                SatIdSet removed;
+                for (size_t r = i; r < last; r++) {
+                    removed.insert(records[r] & 0x1FFFF);
+                }
+                satNet.removeIf([&removed](const Sat& satellite) {
+                    return removed.contains(satellite.getID());
+                });
+            } else {
+                for (size_t r = i; r < last; r++) {
+                    satNet.tryRemove(records[r] & 0x1FFFF);
+                }
+            }
+        } else if (operation == SETSTATE) {
+            std::vector<int> ids;
+            std::vector<STATE> states;
+            for (size_t r = i; r < last; r++) {
+                ids.push_back(records[r] & 0x1FFFF);
+                states.push_back((STATE)((records[r] >> 21) & 3));
+            }
+            satNet.setStates(ids.data(), states.data(), ids.size(), nullptr);
+        } else {
+            // a second sweep right after the first finds nothing
+            satNet.removeDeorbited();
+        }
+        i = last;
+    }
+    return (int)records.size();
+}
+
+// JOURNALED SATNET
+
+JournaledSatNet::JournaledSatNet(const std::string& snapshotPath, const std::string& journalPath, int groupSize)
+        : m_snapshotPath(snapshotPath), m_replayed(0), m_journal(journalPath, recover(journalPath)),
+          m_groupSize(groupSize < 1 ? 1 : groupSize) {
+}
+
+uint64_t JournaledSatNet::recover(const std::string& journalPath){
+    uint64_t base = 0;
+    if (access(m_snapshotPath.c_str(), F_OK) == 0) {
+        SatImage image(m_snapshotPath);
+        base = image.getChecksum();
+        m_satNet.loadSnapshot(m_snapshotPath);
+    }
+    m_replayed = SatJournal::replay(journalPath, base, m_satNet);
+    return base;
+}
+
+void JournaledSatNet::logged(){
+    if (m_journal.pending() >= m_groupSize) {
+        m_journal.commit();
+    }
+}
+
+// A change is logged only once it is known to go through: a duplicate, an
+// unknown ID or an ID out of range goes straight to m_satNet for its result
+// or exception, and changes nothing.
+void JournaledSatNet::insert(const Sat& satellite){
+    int id = satellite.getID();
+    if (id >= MINID && id <= MAXID && !m_satNet.findSatellite(id)) {
+        m_journal.logInsert(satellite);
+        logged();
+    }
+    m_satNet.insert(satellite);
+}
+
+RESULT JournaledSatNet::tryInsert(const Sat& satellite){
+    int id = satellite.getID();
+    if (id >= MINID && id <= MAXID && !m_satNet.findSatellite(id)) {
+        m_journal.logInsert(satellite);
+        logged();
+    }
+    return m_satNet.tryInsert(satellite);
+}
+
+void JournaledSatNet::remove(int id){
+    tryRemove(id);
+}
+
+RESULT JournaledSatNet::tryRemove(int id){
+    if (m_satNet.findSatellite(id)) {
+        m_journal.logRemove(id);
+        logged();
+    }
+    return m_satNet.tryRemove(id);
+}
+
+bool JournaledSatNet::setState(int id, STATE state){
+    if (!m_satNet.findSatellite(id)) {
+        return false;
+    }
+    m_journal.logSetState(id, state);
+    logged();
+    return m_satNet.setState(id, state);
+}
+
+int JournaledSatNet::removeDeorbited(){
+    if (m_satNet.countSatellites(DEORBITED) == 0) {
+        return 0;
+    }
+    m_journal.logRemoveDeorbited();
+    logged();
+    return m_satNet.removeDeorbited();
+}
+
+void JournaledSatNet::commit(){
+    m_journal.commit();
+}
+
+// the log names the new snapshot before it is written, so a crash at any
+// point leaves a snapshot and a log that open together
+void JournaledSatNet::checkpoint(){
+    std::vector<Sat> sorted(m_satNet.begin(), m_satNet.end());
+    uint64_t next = SatImage::checksum(sorted);
+    m_journal.prepare(next);
+    try {
+        SatImage::save(m_snapshotPath, sorted);
+    } catch (...) {
+        m_journal.abandon();
+        throw;
+    }
+    m_journal.reset(next);
+}
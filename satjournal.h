@@ -0,0 +1,149 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#ifndef SATJOURNAL_H
+#define SATJOURNAL_H
+#include "satnet.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+// An append-only log of fleet changes. Each change is one 4-byte record:
+// the operation in bits 30-31, the ID in bits 0-16 and, for inserts and
+// state changes, the attributes above it as in a SatImage record. Records
+// collect in memory and commit() writes all of them as one group - a count,
+// a checksum and the records - followed by a single fdatasync, so the cost
+// of the sync is shared by every change in the group. Threads that commit
+// while a sync is running wait for it and share the next one.
+//
+// The log starts with a header naming the snapshot it applies on top of (by
+// SatImage checksum, 0 for none). replay() only applies a log to that
+// snapshot, and opening a log on top of any other snapshot (a missing one
+// included) fails rather than throwing its changes away. A checkpoint first
+// records in the header the checksum of the snapshot it is about to write,
+// so after a crash between writing that snapshot and restarting the log, the
+// log is known to be folded in and starts afresh without replaying the old
+// changes twice. A group cut short by a crash fails its checksum; it and
+// anything after it are ignored on replay and cut off when the log is opened
+// again.
+class SatJournal{
+public:
+    friend class Grader;
+    friend class Tester;
+    // opens the log at path for appending; a missing log is started on top
+    // of base. Throws std::runtime_error, leaving the file as it is, if it is
+    // not a log or was written on top of another snapshot than base, unless
+    // it was being checkpointed into base (see prepare)
+    SatJournal(const std::string& path, uint64_t base);
+    SatJournal(const SatJournal& rhs) = delete;
+    SatJournal& operator=(const SatJournal& rhs) = delete;
+    // commits what is pending; errors are dropped, call commit() first to see them
+    ~SatJournal();
+    void logInsert(const Sat& satellite);
+    void logRemove(int id);
+    void logSetState(int id, STATE state);
+    void logRemoveDeorbited();
+    // makes every change logged so far durable; throws std::runtime_error if
+    // the log cannot be written, after which every call throws
+    void commit();
+    // changes logged but not yet committed
+    int pending() const;
+    // records, durably, that a snapshot with checksum next is about to take
+    // in all of the log's changes; if it is written and reset() never runs,
+    // the log is started afresh when it is opened on top of that snapshot
+    void prepare(uint64_t next);
+    // gives up on the checkpoint prepare() named when writing its snapshot
+    // failed part way, perhaps after it replaced the old one: the header is
+    // left naming both, and every later call throws, so no change is ever
+    // committed to a log whose snapshot is unknown
+    void abandon();
+    // empties the log and starts it afresh on top of base, after a snapshot
+    // has taken in all of its changes
+    void reset(uint64_t base);
+    // applies the log at path to satNet if it was written on top of base,
+    // runs of the same operation as one batch; returns the number of
+    // records applied, 0 if the log is missing or belongs to another snapshot
+    static int replay(const std::string& path, uint64_t base, SatNet& satNet);
+
+private:
+    enum OPERATION {INSERT, REMOVE, SETSTATE, REMOVEDEORBITED};
+    static const uint32_t VERSION = 2;
+    struct Header{
+        char m_magic[8];            // "SATLOG\r\n"
+        uint32_t m_version;
+        uint32_t m_checkpointing;   // 1 once prepare() has named m_next
+        uint64_t m_base;            // the SatImage checksum of the snapshot underneath, 0 for none
+        uint64_t m_next;            // the snapshot a checkpoint is writing, if m_checkpointing
+    };
+    struct GroupHeader{
+        uint32_t m_count;   // records in the group
+        uint32_t m_check;   // low half of the FNV-1a hash of the records
+    };
+
+    std::string m_path;
+    int m_fd;
+    uint64_t m_base;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_synced;   // a group was made durable, or the log failed
+    std::vector<uint32_t> m_pending;    // records not yet handed to a sync
+    uint64_t m_logged;                  // records ever logged
+    uint64_t m_durable;                 // records known to be on disk
+    bool m_syncing;                     // a thread is writing a group
+    bool m_failed;                      // a write failed; the log no longer matches the fleet
+
+    void append(uint32_t record);
+    // writes one group and syncs it, without the lock
+    void writeGroup(const std::vector<uint32_t>& records);
+    // writes a fresh header over the whole file
+    void start(uint64_t base);
+    // writes the header in place and syncs it
+    void writeHeader(bool checkpointing, uint64_t next);
+    // the records of every intact group of the log in bytes, and where they end
+    static bool readGroups(const std::vector<char>& bytes, uint64_t base, std::vector<uint32_t>& records, size_t& end);
+    static bool readFile(const std::string& path, std::vector<char>& bytes);
+    static uint32_t pack(OPERATION operation, int id, ALT alt, INCLIN inclin, STATE state);
+    static uint32_t check(const uint32_t* records, size_t count);
+};
+
+// A SatNet that logs every change to a SatJournal and checkpoints to a
+// snapshot file. Opening one loads the snapshot, replays the log on top and
+// keeps logging; changes become durable in groups, on commit() or every
+// groupSize changes, and checkpoint() folds the log into a fresh snapshot.
+// Each change is logged before it is applied to the fleet, so if the log
+// throws, the fleet is left as it was. One thread at a time may change it,
+// as with SatNet.
+class JournaledSatNet{
+public:
+    friend class Grader;
+    friend class Tester;
+    // groupSize 1 syncs every change
+    JournaledSatNet(const std::string& snapshotPath, const std::string& journalPath, int groupSize = 64);
+    void insert(const Sat& satellite);
+    RESULT tryInsert(const Sat& satellite);
+    void remove(int id);
+    RESULT tryRemove(int id);
+    bool setState(int id, STATE state);
+    int removeDeorbited();
+    // makes every change so far durable
+    void commit();
+    // writes the fleet to the snapshot file and empties the log
+    void checkpoint();
+    // the fleet, for every query
+    const SatNet& fleet() const {return m_satNet;}
+    // records replayed from the log when it was opened
+    int replayed() const {return m_replayed;}
+
+private:
+    std::string m_snapshotPath;
+    SatNet m_satNet;
+    int m_replayed;
+    SatJournal m_journal;
+    int m_groupSize;
+
+    // loads the snapshot if there is one, replays the log, returns the snapshot's checksum
+    uint64_t recover(const std::string& journalPath);
+    // commits once groupSize changes are pending; called after a change is
+    // logged and before it is applied, so a change that cannot be logged is
+    // never applied
+    void logged();
+};
+#endif
@@ -1,93 +1,356 @@
 // UMBC - CMSC 341 - Fall 2023 - Proj2
 #include "satnet.h"
+#include "satimage.h"
+#include "satsnapshot.h"
+#include "satworkers.h"
+#include "satwriter.h"
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
+
+// STATISTICS HOOKS
+// SATSTAT(statement) runs statement only in a SATNET_STATS build, and
+// SATTIMER(operation) times the rest of the enclosing call into the latency
+// histogram, SATBATCHTIMER(operation, calls) the same for a batch of that
+// many calls; without the flag they expand to nothing.
+#ifdef SATNET_STATS
+namespace {
+class SatOpTimer{
+public:
+    SatOpTimer(SatNetStats& stats, SatNetStats::OPERATION operation, uint64_t calls)
+            : m_stats(stats), m_operation(operation), m_calls(calls), m_start(std::chrono::steady_clock::now()) {}
+    ~SatOpTimer() {
+        std::chrono::nanoseconds ns = std::chrono::steady_clock::now() - m_start;
+        m_stats.record(m_operation, (uint64_t)ns.count(), m_calls);
+    }
+private:
+    SatNetStats& m_stats;
+    SatNetStats::OPERATION m_operation;
+    uint64_t m_calls;
+    std::chrono::steady_clock::time_point m_start;
+};
+}
+#define SATSTAT(statement) statement
+#define SATTIMER(operation) SatOpTimer satOpTimer(m_stats, SatNetStats::operation, 1)
+#define SATBATCHTIMER(operation, calls) SatOpTimer satOpTimer(m_stats, SatNetStats::operation, calls)
+#else
+#define SATSTAT(statement)
+#define SATTIMER(operation)
+#define SATBATCHTIMER(operation, calls)
+#endif
+
+// NODE POOL
+// the arrays stay empty, without even the NOSAT slot, until the first node
+// is handed out, so an empty pool (a moved-from one included) owns no memory
+SatPool::SatPool() : m_freeList(NOSAT), m_live(0) {}
+
+void SatPool::addSentinel(size_t room){
+    m_nodes.reserve(room + 1);
+    m_counts.reserve(room + 1);
+    // slot NOSAT is the empty subtree, never handed out
+    m_nodes.resize(1);
+    m_counts.resize(1);
+    m_nodes[NOSAT].m_left = NOSAT;
+    m_nodes[NOSAT].m_right = NOSAT;
+    m_nodes[NOSAT].m_id = DEFAULT_ID;
+    m_nodes[NOSAT].m_height = 0;
+    m_nodes[NOSAT].m_alt = DEFAULT_ALT;
+    m_nodes[NOSAT].m_inclin = DEFAULT_INCLIN;
+    m_nodes[NOSAT].m_state = DEFAULT_STATE;
+}
+
+SatIndex SatPool::allocate(const Sat& satellite){
+    SatIndex node = m_freeList;
+    if (node != NOSAT) {
+        m_freeList = m_nodes[node].m_left;
+    } else {
+        reserve(1);
+        node = (SatIndex)m_nodes.size();
+        m_nodes.push_back(SatNode());
+        m_counts.push_back(SatCounts());
+    }
+    assign(node, satellite);
+    m_live++;
+    return node;
+}
+
+SatIndex SatPool::allocateRange(int n){
+    if (m_nodes.empty()) {
+        addSentinel(n);
+    }
+    SatIndex first = (SatIndex)m_nodes.size();
+    m_nodes.resize(m_nodes.size() + n);
+    m_counts.resize(m_counts.size() + n);
+    m_live += n;
+    return first;
+}
+
+void SatPool::assign(SatIndex node, const Sat& satellite){
+    SatNode& slot = m_nodes[node];
+    slot.m_left = NOSAT;
+    slot.m_right = NOSAT;
+    slot.m_id = satellite.getID();
+    slot.m_height = 1;
+    slot.m_alt = satellite.getAlt();
+    slot.m_inclin = satellite.getInclin();
+    slot.m_state = satellite.getState();
+}
+
+void SatPool::release(SatIndex node){
+    if (node == NOSAT) {
+        return;
+    }
+    m_nodes[node].m_left = m_freeList;
+    m_freeList = node;
+    m_live--;
+}
+
+// grows geometrically, so reserving one node per insert stays amortized O(1)
+void SatPool::reserve(int n){
+    if (m_nodes.empty()) {
+        addSentinel(n);
+        return;
+    }
+    size_t needed = m_nodes.size() + n;
+    if (needed > m_nodes.capacity()) {
+        needed = std::max(needed, 2 * m_nodes.capacity());
+        m_nodes.reserve(needed);
+        m_counts.reserve(needed);
+    }
+}
+
+void SatPool::reset(){
+    if (!m_nodes.empty()) {
+        m_nodes.resize(1);
+        m_counts.resize(1);
+    }
+    m_freeList = NOSAT;
+    m_live = 0;
+}
+
+// a copy is bound by memory bandwidth, so the gain levels off after a few threads
+void SatPool::copyFrom(const SatPool& rhs, SatWorkers& workers){
+    size_t size = rhs.m_nodes.size();
+    m_nodes.resize(size);
+    m_counts.resize(size);
+    int slices = 4 * workers.threads();
+    workers.run(slices, [this, &rhs, size, slices](int i) {
+        size_t lo = size * i / slices;
+        size_t hi = size * (i + 1) / slices;
+        std::copy(rhs.m_nodes.begin() + lo, rhs.m_nodes.begin() + hi, m_nodes.begin() + lo);
+        std::copy(rhs.m_counts.begin() + lo, rhs.m_counts.begin() + hi, m_counts.begin() + lo);
+    });
+    m_freeList = rhs.m_freeList;
+    m_live = rhs.m_live;
+}
+
+Sat SatPool::satellite(SatIndex node) const{
+    const SatNode& slot = m_nodes[node];
+    return Sat(slot.m_id, slot.getAlt(), slot.getInclin(), slot.getState());
+}
+
+// ATTRIBUTE INDEX
+const int SatIdSet::NUMWORDS;
+
+void SatIdSet::insert(int id){
+    if (m_words.empty()) {
+        m_words.resize(NUMWORDS, 0);
+    }
+    m_words[(id - MINID) / WORDBITS] |= uint64_t(1) << ((id - MINID) % WORDBITS);
+}
+
+void SatIdSet::erase(int id){
+    if (!m_words.empty()) {
+        m_words[(id - MINID) / WORDBITS] &= ~(uint64_t(1) << ((id - MINID) % WORDBITS));
+    }
+}
+
+bool SatIdSet::contains(int id) const{
+    if (m_words.empty() || id < MINID || id > MAXID) {
+        return false;
+    }
+    return (m_words[(id - MINID) / WORDBITS] >> ((id - MINID) % WORDBITS)) & 1;
+}
+
+bool SatIdSet::empty() const{
+    for (size_t w = 0; w < m_words.size(); w++) {
+        if (m_words[w] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int SatIdSet::size() const{
+    int count = 0;
+    for (size_t w = 0; w < m_words.size(); w++) {
+        count += __builtin_popcountll(m_words[w]);
+    }
+    return count;
+}
+
+void SatIdSet::clear(){
+    std::vector<uint64_t>().swap(m_words);
+}
+
+// a set without words counts as all zeros
+SatIdSet& SatIdSet::operator&=(const SatIdSet& rhs){
+    if (rhs.m_words.empty()) {
+        clear();
+    } else {
+        for (size_t w = 0; w < m_words.size(); w++) {
+            m_words[w] &= rhs.m_words[w];
+        }
+    }
+    return *this;
+}
+
+SatIdSet& SatIdSet::operator|=(const SatIdSet& rhs){
+    if (m_words.empty()) {
+        m_words = rhs.m_words;
+    } else {
+        for (size_t w = 0; w < rhs.m_words.size(); w++) {
+            m_words[w] |= rhs.m_words[w];
+        }
+    }
+    return *this;
+}
+
+SatIdSet& SatIdSet::operator-=(const SatIdSet& rhs){
+    if (!m_words.empty()) {
+        for (size_t w = 0; w < rhs.m_words.size(); w++) {
+            m_words[w] &= ~rhs.m_words[w];
+        }
+    }
+    return *this;
+}
+
+bool SatIdSet::operator==(const SatIdSet& rhs) const{
+    if (m_words.empty() || rhs.m_words.empty()) {
+        return empty() && rhs.empty();
+    }
+    return m_words == rhs.m_words;
+}
+
+std::vector<int> SatIdSet::ids() const{
+    std::vector<int> ids;
+    ids.reserve(size());
+    forEach([&ids](int id) {
+        ids.push_back(id);
+    });
+    return ids;
+}
+
+void SatAttrIndex::add(int id, ALT alt, INCLIN inclin, STATE state){
+    m_state[state].insert(id);
+    m_alt[alt].insert(id);
+    m_inclin[inclin].insert(id);
+}
+
+void SatAttrIndex::remove(int id, ALT alt, INCLIN inclin, STATE state){
+    m_state[state].erase(id);
+    m_alt[alt].erase(id);
+    m_inclin[inclin].erase(id);
+}
+
+void SatAttrIndex::changeState(int id, STATE from, STATE to){
+    m_state[from].erase(id);
+    m_state[to].insert(id);
+}
+
+void SatAttrIndex::clear(){
+    for (int i = 0; i < NUMSTATES; i++) m_state[i].clear();
+    for (int i = 0; i < NUMALTS; i++) m_alt[i].clear();
+    for (int i = 0; i < NUMINCLINS; i++) m_inclin[i].clear();
+}
+
 SatNet::SatNet(){
-    m_root = nullptr;
+    m_root = NOSAT;
 }
 
+SatNet::SatNet(const SatNet & rhs) : m_root(rhs.m_root), m_pool(rhs.m_pool), m_index(rhs.m_index) {
+}
+
+SatNet::SatNet(SatNet && rhs) noexcept : SatNet() {
+    swap(rhs);
+}
+
+// containers of fleets move them instead of copying when they grow
+static_assert(std::is_nothrow_move_constructible<SatNet>::value, "moving a SatNet must not throw");
+static_assert(std::is_nothrow_move_assignable<SatNet>::value, "moving a SatNet must not throw");
+
 SatNet::~SatNet(){
     clear();
 }
 
 // GET ROOT
-Sat* SatNet::getRoot() const {
+SatIndex SatNet::getRoot() const {
     return m_root;
 }
 
 // ROTATIONS
 // RIGHT ROTATION
-Sat* SatNet::rightRotate(Sat *node)  {
-    Sat* newRoot = node->getLeft();
-    Sat* temp = newRoot->getRight();
+SatIndex SatNet::rightRotate(SatIndex node)  {
+    SatIndex newRoot = m_pool[node].m_left;
+    SatIndex temp = m_pool[newRoot].m_right;
 
-    newRoot->setRight(node);
-    node->setLeft(temp);
+    m_pool[newRoot].m_right = node;
+    m_pool[node].m_left = temp;
 
-    // Update heights
-    node->setHeight(1 + std::max(
-            (node->getLeft() ? node->getLeft()->getHeight() : 0),
-            (node->getRight() ? node->getRight()->getHeight() : 0)
-    ));
-
-    newRoot->setHeight(1 + std::max(
-            (newRoot->getLeft() ? newRoot->getLeft()->getHeight() : 0),
-            (newRoot->getRight() ? newRoot->getRight()->getHeight() : 0)
-    ));
+    // Update heights and counts, the old root is now below the new one
+    updateHeight(node);
+    updateHeight(newRoot);
 
     return newRoot;
 }
 // LEFT ROTATION
-Sat* SatNet::leftRotate(Sat *node) {
-    Sat* newRoot = node->getRight();
-    Sat* temp = newRoot->getLeft();
+SatIndex SatNet::leftRotate(SatIndex node) {
+    SatIndex newRoot = m_pool[node].m_right;
+    SatIndex temp = m_pool[newRoot].m_left;
 
-    newRoot->setLeft(node);
-    node->setRight(temp);
+    m_pool[newRoot].m_left = node;
+    m_pool[node].m_right = temp;
 
-    // Update heights
-    node->setHeight(1 + std::max(
-            (node->getLeft() ? node->getLeft()->getHeight() : 0),
-            (node->getRight() ? node->getRight()->getHeight() : 0)
-    ));
-
-    newRoot->setHeight(1 + std::max(
-            (newRoot->getLeft() ? newRoot->getLeft()->getHeight() : 0),
-            (newRoot->getRight() ? newRoot->getRight()->getHeight() : 0)
-    ));
+    // Update heights and counts, the old root is now below the new one
+    updateHeight(node);
+    updateHeight(newRoot);
 
     return newRoot;
 }
 
 // AVL TREE METHODS
 // BALANCE
-int SatNet::getBalance(Sat *node) {
-    if (node == nullptr) {
+// the empty subtree has height 0, so no null checks are needed
+int SatNet::getBalance(SatIndex node) const {
+    // NOSAT may be the root of an empty tree whose pool has no slots yet
+    if (node == NOSAT) {
         return 0;
     }
-
-    int leftHeight = (node->getLeft() ? node->getLeft()->getHeight() : 0);
-    int rightHeight = (node->getRight() ? node->getRight()->getHeight() : 0);
-
-    return leftHeight - rightHeight;
+    const SatNode& n = m_pool[node];
+    return (int)m_pool[n.m_left].m_height - (int)m_pool[n.m_right].m_height;
 }
 
 // UPDATE HEIGHT
-void SatNet::updateHeight(Sat *node) {
-    if (node != nullptr) {
-        node->setHeight(1 + std::max(
-                (node->getLeft() ? node->getLeft()->getHeight() : 0),
-                (node->getRight() ? node->getRight()->getHeight() : 0)
-        ));
-    }
+// also recomputes the subtree counts, so anything that changes a node's
+// children or payload must call this on the way back up
+void SatNet::updateHeight(SatIndex node) {
+    SatNode& n = m_pool[node];
+    n.m_height = 1 + std::max(m_pool[n.m_left].m_height, m_pool[n.m_right].m_height);
+
+    SatCounts& counts = m_pool.counts(node);
+    counts = m_pool.counts(n.m_left);
+    counts.add(m_pool.counts(n.m_right));
+    counts.add(n.getState(), n.getAlt(), n.getInclin());
 }
 
 
 // BST VALIDITY
-bool SatNet::getBSTValidity(Sat* node, int min, int max) const {
-    if (node == nullptr) {
+bool SatNet::getBSTValidity(SatIndex node, int min, int max) const {
+    if (node == NOSAT) {
         return true;
     }
 
-    int key = node->m_id;
+    int key = m_pool[node].m_id;
 
     // Check if the key value is within the valid range
     if (key < min || key > max) {
@@ -95,13 +358,13 @@ bool SatNet::getBSTValidity(Sat* node, int min, int max) const {
     }
 
     // Recursively check the left and right subtrees
-    return getBSTValidity(node->getLeft(), min, key - 1) &&
-            getBSTValidity(node->getRight(), key + 1, max);
+    return getBSTValidity(m_pool[node].m_left, min, key - 1) &&
+            getBSTValidity(m_pool[node].m_right, key + 1, max);
 }
 
 // BALANCE AVL TREE
-Sat* SatNet::balance(Sat *node) {
-    if (node == nullptr) {
+SatIndex SatNet::balance(SatIndex node) {
+    if (node == NOSAT) {
         return node;
     }
 
@@ -109,18 +372,26 @@ Sat* SatNet::balance(Sat *node) {
 
     // Left-heavy
     if (balance > 1) {
-        if (getBalance(node->getLeft()) < 0) {
+        if (getBalance(m_pool[node].m_left) < 0) {
             // Left-Right case: Left rotation on left child, then right rotation on current node
-            node->setLeft(leftRotate(node->getLeft()));
+            SatIndex left = leftRotate(m_pool[node].m_left);
+            m_pool[node].m_left = left;
+            SATSTAT(m_stats.m_doubleRotations.add(1));
+        } else {
+            SATSTAT(m_stats.m_singleRotations.add(1));
         }
         // Right rotation on current node
         return rightRotate(node);
     }
     // Right-heavy
     if (balance < -1) {
-        if (getBalance(node->getRight()) > 0) {
+        if (getBalance(m_pool[node].m_right) > 0) {
             // Right-Left case: Right rotation on right child, then left rotation on current node
-            node->setRight(rightRotate(node->getRight()));
+            SatIndex right = rightRotate(m_pool[node].m_right);
+            m_pool[node].m_right = right;
+            SATSTAT(m_stats.m_doubleRotations.add(1));
+        } else {
+            SATSTAT(m_stats.m_singleRotations.add(1));
         }
         // Left rotation on current node
         return leftRotate(node);
@@ -130,265 +401,703 @@ Sat* SatNet::balance(Sat *node) {
 }
 
 // INSERTION
-Sat* SatNet::insertRecursive(Sat *node, const Sat &satellite) {
-    if (node == nullptr) {
-        return new Sat(satellite);
+// walks down keeping the address of every link on the path, so the way back
+// up needs neither recursion nor parent pointers. A duplicate is detected on
+// the way down, so no separate lookup is needed.
+RESULT SatNet::insertIterative(const Sat &satellite) {
+    // the links on the path point into the node array, which must not move
+    m_pool.reserve(1);
+
+    SatIndex* path[MAXHEIGHT];
+    int depth = 0;
+    SatIndex* link = &m_root;
+    while (*link != NOSAT) {
+        SatNode& node = m_pool[*link];
+        if (satellite.getID() == (int)node.m_id) {
+            SATSTAT(m_stats.descent(depth + 1));
+            return DUPLICATE;
+        }
+        path[depth++] = link;
+        link = (satellite.getID() < (int)node.m_id) ? &node.m_left : &node.m_right;
     }
+    SATSTAT(m_stats.descent(depth));
 
-    if (satellite.getID() < node->getID()) {
-        node->setLeft(insertRecursive(node->getLeft(), satellite));
-    } else if (satellite.getID() > node->getID()) {
-        node->setRight(insertRecursive(node->getRight(), satellite));
-    } else {
-        return node;
-    }
+    // a new leaf has height 1 and counts only itself
+    SatIndex leaf = m_pool.allocate(satellite);
+    SATSTAT(m_stats.m_allocations.add(1));
+    updateHeight(leaf);
+    *link = leaf;
+    m_index.add(satellite.getID(), satellite.getAlt(), satellite.getInclin(), satellite.getState());
 
-    // Update height and balance
-    updateHeight(node);
-    return balance(node);
+    retrace(path, depth, -1, satellite, satellite, true);
+    return SUCCESS;
 }
 
-// CLEAR
-void SatNet::clearRecursive(Sat *node) {
-    if (node == nullptr) {
-        return;
+// RETRACE
+// rebalances the path bottom-up and stops as soon as a subtree comes out
+// with the height it had before: nothing above it can be out of balance.
+// The ancestors above that point still get their counts adjusted by the
+// satellite that was added or removed; on removal, nodes below `split` lost
+// `below` and `split` and above lost `above`.
+void SatNet::retrace(SatIndex* path[], int depth, int split, const Sat& above, const Sat& below, bool added) {
+    int i = depth - 1;
+    for (; i >= 0; i--) {
+        SatIndex node = *path[i];
+        unsigned oldHeight = m_pool[node].m_height;
+        updateHeight(node);
+        SatIndex top = balance(node);
+        *path[i] = top;
+        if (m_pool[top].m_height == oldHeight) {
+            i--;
+            break;
+        }
+    }
+    SATSTAT(m_stats.m_retraces.add(1));
+    SATSTAT(m_stats.m_retraceLevels.add(depth - 1 - i));
+    SATSTAT(m_stats.m_deepestRetrace.raise(depth - 1 - i));
+    for (; i >= 0; i--) {
+        const Sat& changed = (i > split) ? below : above;
+        if (added) {
+            m_pool.counts(*path[i]).add(changed.getState(), changed.getAlt(), changed.getInclin());
+        } else {
+            m_pool.counts(*path[i]).subtract(changed.getState(), changed.getAlt(), changed.getInclin());
+        }
     }
-
-    clearRecursive(node->getLeft());
-    clearRecursive(node->getRight());
-
-    delete node;
-    node = nullptr;
 }
 
 // REMOVE
-Sat* SatNet::removeRecursive(Sat *node, int id) {
-    if (node == nullptr) {
-        return node;
+// an absent ID is detected on the way down, so no separate lookup is needed
+RESULT SatNet::removeIterative(int id) {
+    SatIndex* path[MAXHEIGHT];
+    int depth = 0;
+    SatIndex* link = &m_root;
+    while (*link != NOSAT && (int)m_pool[*link].m_id != id) {
+        path[depth++] = link;
+        SatNode& node = m_pool[*link];
+        link = (id < (int)node.m_id) ? &node.m_left : &node.m_right;
+    }
+    SATSTAT(m_stats.descent(depth + (*link != NOSAT)));
+    if (*link == NOSAT) {
+        return NOT_FOUND;
     }
 
-    // standard bst removal
-    if (id < node->getID()) {
-        node->setLeft(removeRecursive(node->getLeft(), id));
-    } else if (id > node->getID()) {
-        node->setRight(removeRecursive(node->getRight(), id));
+    SatIndex node = *link;
+    Sat removed = m_pool.satellite(node);
+    m_index.remove(id, removed.getAlt(), removed.getInclin(), removed.getState());
+    int split = depth;
+    if (m_pool[node].m_left != NOSAT && m_pool[node].m_right != NOSAT) {
+        // node with two children: the inorder successor (smallest in the right
+        // subtree) takes its place and the successor's node is unlinked instead
+        path[depth++] = link;
+        link = &m_pool[node].m_right;
+        while (m_pool[*link].m_left != NOSAT) {
+            path[depth++] = link;
+            link = &m_pool[*link].m_left;
+        }
+        SatIndex successor = *link;
+        Sat moved = m_pool.satellite(successor);
+        SatNode& target = m_pool[node];
+        target.m_id = moved.getID();
+        target.m_alt = moved.getAlt();
+        target.m_inclin = moved.getInclin();
+        target.m_state = moved.getState();
+        *link = m_pool[successor].m_right;
+        m_pool.release(successor);
+        SATSTAT(m_stats.m_frees.add(1));
+        retrace(path, depth, split, removed, moved, false);
     } else {
         // node with only one child or no child
-        if (node->getLeft() == nullptr || node->getRight() == nullptr) {
-            Sat* temp = (node->getLeft() == nullptr) ? node->getRight() : node->getLeft();
-            // delete node but check if it's the root
-            // if it is, overwrite the root with the new node
-            if (node->getID() == m_root->getID()) {
-                m_root = temp;
-            }
-            delete node;
-            return temp;
+        *link = (m_pool[node].m_left == NOSAT) ? m_pool[node].m_right : m_pool[node].m_left;
+        m_pool.release(node);
+        SATSTAT(m_stats.m_frees.add(1));
+        retrace(path, depth, split, removed, removed, false);
+    }
+    return SUCCESS;
+}
 
+// unlinking the node is up to the caller
+void SatNet::releaseNode(SatIndex node) {
+    const SatNode& n = m_pool[node];
+    m_index.remove(n.m_id, n.getAlt(), n.getInclin(), n.getState());
+    m_pool.release(node);
+    SATSTAT(m_stats.m_frees.add(1));
+}
+
+// FIND SATELLITE
+SatIndex SatNet::findNode(int id) const {
+    SatIndex node = m_root;
+    SATSTAT(int visited = 0);
+    while (node != NOSAT) {
+        SATSTAT(visited++);
+        const SatNode& n = m_pool[node];
+        if (id == (int)n.m_id) {
+            SATSTAT(m_stats.descent(visited));
+            return node;
         }
-        else {
-            // node with two children: Get the inorder successor (smallest in the right subtree)
-            Sat* temp = findMin(node->getRight());
+        node = (id < (int)n.m_id) ? n.m_left : n.m_right;
+    }
+    SATSTAT(m_stats.descent(visited));
+    return NOSAT;
+}
 
-            // Copy the inorder successor's data to this node
-            node->setID(temp->getID());
+// BATCHED LOOKUP
+// Up to BATCHLANES descents are in flight at once. Each round moves every lane
+// down one level and prefetches the node it lands on, so by the time the lane
+// comes round again the node is usually in cache. A lane that finishes takes
+// the next ID in the batch; once the batch runs dry the lanes drain.
+template <class Step, class Visit>
+void SatNet::descendBatch(const int* ids, size_t n, bool withCounts, Step step, Visit visit) const {
+    size_t query[BATCHLANES];
+    SatIndex node[BATCHLANES];
+    SATSTAT(uint64_t visited[BATCHLANES]);
+    int lanes = 0;
+    size_t next = 0;
+    while (lanes < BATCHLANES && next < n) {
+        query[lanes] = next++;
+        node[lanes] = m_root;
+        SATSTAT(visited[lanes] = 0);
+        lanes++;
+    }
+
+    while (lanes > 0) {
+        int i = 0;
+        while (i < lanes) {
+            int id = ids[query[i]];
+            SatIndex at = node[i];
+            if (at != NOSAT) {
+                SATSTAT(visited[i]++);
+                step(query[i], at);
+                const SatNode& current = m_pool[at];
+                if (id != (int)current.m_id) {
+                    node[i] = (id < (int)current.m_id) ? current.m_left : current.m_right;
+                    __builtin_prefetch(&m_pool[node[i]]);
+                    if (withCounts) {
+                        __builtin_prefetch(&m_pool.counts(node[i]));
+                    }
+                    i++;
+                    continue;
+                }
+            }
 
-            // Delete the inorder successor
-            node->setRight(removeRecursive(node->getRight(), temp->getID()));
+            // found it or fell off the tree
+            visit(query[i], at);
+            SATSTAT(m_stats.descent(visited[i]));
+            if (next < n) {
+                query[i] = next++;
+                node[i] = m_root;
+                SATSTAT(visited[i] = 0);
+                i++;
+            } else {
+                lanes--;
+                query[i] = query[lanes];
+                node[i] = node[lanes];
+                SATSTAT(visited[i] = visited[lanes]);
+            }
         }
     }
+}
 
-    // Update height and balance
-    updateHeight(node);
-    return balance(node);
+// ITERATION
+SatNet::const_iterator SatNet::begin() const {
+    SatIterator it(&m_pool, m_root);
+    it.pushSpine(m_root, true);
+    return it;
 }
 
-// FIND MIN
-Sat* SatNet::findMin(Sat *node) {
-    if (node == nullptr) {
-        return node;
-    }
+SatNet::const_iterator SatNet::end() const {
+    return SatIterator(&m_pool, m_root);
+}
 
-    while (node->getLeft() != nullptr) {
-        node = node->getLeft();
+// the path down to id, cut back to the last node that was >= id
+SatNet::const_iterator SatNet::lower_bound(int id) const {
+    SatIterator it(&m_pool, m_root);
+    int found = 0;
+    SatIndex node = m_root;
+    while (node != NOSAT) {
+        it.m_path[it.m_depth++] = node;
+        if ((int)m_pool[node].m_id >= id) {
+            found = it.m_depth;
+            node = m_pool[node].m_left;
+        } else {
+            node = m_pool[node].m_right;
+        }
     }
+    it.m_depth = found;
+    return it;
+}
 
-    return node;
+SatNet::const_iterator SatNet::upper_bound(int id) const {
+    return lower_bound(id + 1);
 }
 
-// FIND SATELLITE
-bool SatNet::findSatelliteRecursive(Sat* node, int id) const {
-    if (node == nullptr) {
-        return false;
+std::pair<SatNet::const_iterator, SatNet::const_iterator> SatNet::equal_range(int id) const {
+    return std::make_pair(lower_bound(id), upper_bound(id));
+}
+
+void SatIterator::pushSpine(SatIndex node, bool descendLeft) {
+    while (node != NOSAT) {
+        m_path[m_depth++] = node;
+        node = descendLeft ? (*m_pool)[node].m_left : (*m_pool)[node].m_right;
     }
+}
 
-    if (id == node->getID()) {
-        return true;
-    } else if (id < node->getID()) {
-        return findSatelliteRecursive(node->getLeft(), id);
-    } else {
-        return findSatelliteRecursive(node->getRight(), id);
+// the successor is the leftmost node of the right subtree or, failing that,
+// the first ancestor reached from its left
+SatIterator& SatIterator::operator++() {
+    SatIndex right = (*m_pool)[m_path[m_depth - 1]].m_right;
+    if (right != NOSAT) {
+        pushSpine(right, true);
+        return *this;
     }
+    SatIndex child = m_path[--m_depth];
+    while (m_depth > 0 && (*m_pool)[m_path[m_depth - 1]].m_right == child) {
+        child = m_path[--m_depth];
+    }
+    return *this;
 }
 
-// SET STATE
-bool SatNet::setStateRecursive(Sat* node, int id, STATE state) {
-    if (node == nullptr) {
-        return false;
+// the mirror image of operator++; from end() it goes to the largest ID
+SatIterator& SatIterator::operator--() {
+    if (m_depth == 0) {
+        pushSpine(m_root, false);
+        return *this;
+    }
+    SatIndex left = (*m_pool)[m_path[m_depth - 1]].m_left;
+    if (left != NOSAT) {
+        pushSpine(left, false);
+        return *this;
     }
+    SatIndex child = m_path[--m_depth];
+    while (m_depth > 0 && (*m_pool)[m_path[m_depth - 1]].m_left == child) {
+        child = m_path[--m_depth];
+    }
+    return *this;
+}
 
-    if (id == node->getID()) {
-        node->setState(state);
-        return true;
-    } else if (id < node->getID()) {
-        return setStateRecursive(node->getLeft(), id, state);
-    } else {
-        return setStateRecursive(node->getRight(), id, state);
+bool SatIterator::operator==(const SatIterator& rhs) const {
+    if (m_depth == 0 || rhs.m_depth == 0) {
+        return m_depth == rhs.m_depth;
     }
+    return m_path[m_depth - 1] == rhs.m_path[rhs.m_depth - 1];
 }
 
 // LIST SATELLITES
-void SatNet::listSatellitesRecursive(Sat* node) const {
-    if (node != nullptr) {
-        listSatellitesRecursive(node->getLeft());
-        // Print the satellite information
-        cout << node->getID() << ": " << node->getStateStr() << ": " << node->getInclinStr() << ": " << node->getAltStr() << endl;
-        listSatellitesRecursive(node->getRight());
+// the lines go through the writer's buffer and tables, so there is one flush
+// for the whole fleet and no string is built per satellite
+void SatNet::listSatellites(SatWriter& out, FORMAT format) const {
+    out.writeHeader(format);
+    forEachInRange(MINID, MAXID, [&out, format](const Sat& satellite) {
+        out.writeSatellite(satellite.getID(), satellite.getAlt(), satellite.getInclin(), satellite.getState(), format);
+    });
+    out.flush();
+}
+
+// REMOVE IF
+// in-order walk with an explicit stack
+void SatNet::flattenNodes(std::vector<SatIndex>& nodes) const {
+    nodes.reserve(nodes.size() + m_pool.size());
+    SatIndex stack[MAXHEIGHT];
+    int depth = 0;
+    SatIndex node = m_root;
+    while (node != NOSAT || depth > 0) {
+        while (node != NOSAT) {
+            stack[depth++] = node;
+            node = m_pool[node].m_left;
+        }
+        node = stack[--depth];
+        nodes.push_back(node);
+        node = m_pool[node].m_right;
     }
 }
 
-// REMOVE DEORBITED
-Sat* SatNet::removeDeorbitedRecursive(Sat* node) {
-    if (node == nullptr) {
-        return node;
+// same shape as buildBalanced, but relinks nodes that already exist
+SatIndex SatNet::linkBalanced(const SatIndex* first, const SatIndex* last) {
+    if (first == last) {
+        return NOSAT;
     }
+    const SatIndex* middle = first + (last - first) / 2;
+    SatIndex node = *middle;
+    SatIndex left = linkBalanced(first, middle);
+    SatIndex right = linkBalanced(middle + 1, last);
+    m_pool[node].m_left = left;
+    m_pool[node].m_right = right;
+    updateHeight(node);
+    return node;
+}
 
-    // Recursively process the left and right subtrees
-    node->setLeft(removeDeorbitedRecursive(node->getLeft()));
-    node->setRight(removeDeorbitedRecursive(node->getRight()));
+// COUNT SATELLITES
+// one root-to-leaf descent: whenever we go right, the node and its whole left
+// subtree are <= maxID, so their totals are added without visiting them
+void SatNet::countUpTo(int maxID, SatCounts& counts) const {
+    SatIndex node = m_root;
+    while (node != NOSAT) {
+        const SatNode& n = m_pool[node];
+        if ((int)n.m_id <= maxID) {
+            counts.add(m_pool.counts(n.m_left));
+            counts.add(n.getState(), n.getAlt(), n.getInclin());
+            node = n.m_right;
+        } else {
+            node = n.m_left;
+        }
+    }
+}
 
-    // Check and remove satellites with DEORBITED state
-    if (node->getState() == DEORBITED) {
-        // Node has DEORBITED state, remove it
-        return removeNode(node);
+// BULK LOADING
+void SatNet::sortBatch(std::vector<Sat>& satellites, SatWorkers* workers) {
+    auto byID = [](const Sat& a, const Sat& b) {
+        return a.getID() < b.getID();
+    };
+    if (workers == nullptr || workers->threads() == 1 || satellites.size() < (size_t)PARALLELMIN) {
+        std::stable_sort(satellites.begin(), satellites.end(), byID);
+        return;
     }
 
-    // Update height and balance
-    updateHeight(node);
-    return balance(node);
+    // a power of two slices, so every merge round pairs them all up
+    int slices = 1;
+    while (slices < workers->threads()) {
+        slices *= 2;
+    }
+    std::vector<size_t> bounds(slices + 1);
+    for (int i = 0; i <= slices; i++) {
+        bounds[i] = satellites.size() * i / slices;
+    }
+    std::vector<Sat>::iterator begin = satellites.begin();
+    workers->run(slices, [begin, &bounds, &byID](int i) {
+        std::stable_sort(begin + bounds[i], begin + bounds[i + 1], byID);
+    });
+    // inplace_merge keeps the left slice first on equal IDs, so the result is stable
+    for (int width = 1; width < slices; width *= 2) {
+        workers->run(slices / (2 * width), [begin, &bounds, &byID, width](int i) {
+            int lo = 2 * width * i;
+            std::inplace_merge(begin + bounds[lo], begin + bounds[lo + width], begin + bounds[lo + 2 * width], byID);
+        });
+    }
 }
 
-// REMOVE NODE
-Sat* SatNet::removeNode(Sat* node) {
-    if (node == nullptr) {
-        return node;
+// stable sort keeps the first of repeated IDs in front of the others
+int SatNet::prepareBatch(std::vector<Sat>& satellites, SatLoadReport& report, SatWorkers* workers) {
+    sortBatch(satellites, workers);
+
+    int kept = 0;
+    for (size_t i = 0; i < satellites.size(); i++) {
+        int id = satellites[i].getID();
+        if (id < MINID || id > MAXID) {
+            report.m_outOfRange.push_back(id);
+        } else if (kept > 0 && satellites[kept - 1].getID() == id) {
+            report.m_duplicates.push_back(id);
+        } else {
+            satellites[kept++] = satellites[i];
+        }
     }
+    return kept;
+}
 
-    if (node->getLeft() == nullptr) {
-        Sat* temp = node->getRight();
-        delete node;
-        return temp; // Return the new root (or nullptr if the tree is empty)
-    } else if (node->getRight() == nullptr) {
-        Sat* temp = node->getLeft();
-        delete node;
-        return temp; // Return the new root (or nullptr if the tree is empty)
-    } else {
-        Sat* temp = findMin(node->getRight());
-        node->setID(temp->getID());
-        node->setRight(removeRecursive(node->getRight(), temp->getID()));
+void SatNet::flatten(std::vector<Sat>& satellites) const {
+    std::vector<SatIndex> nodes;
+    flattenNodes(nodes);
+    satellites.reserve(satellites.size() + nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        satellites.push_back(m_pool.satellite(nodes[i]));
+    }
+}
+
+// The middle element becomes the root, so the two halves differ in size by
+// at most one and the heights come out right without any rotation. Nodes are
+// numbered in ID order, so every subtree owns a known block of the pool and
+// the subtrees a few levels down can be built by different threads; the
+// levels above them are linked afterwards.
+SatIndex SatNet::buildBalanced(const Sat* first, const Sat* last, SatWorkers* workers) {
+    size_t count = last - first;
+    if (count == 0) {
+        return NOSAT;
+    }
+    SatIndex base = m_pool.allocateRange((int)count);
+    SATSTAT(m_stats.m_allocations.add(count));
+    if (workers == nullptr || workers->threads() == 1 || count < (size_t)PARALLELMIN) {
+        return buildRange(first, 0, count, base, 0, -1);
     }
 
+    // a few subtrees per thread, so the shared task counter can even them out
+    int stopAt = 0;
+    while ((1 << stopAt) < 4 * workers->threads()) {
+        stopAt++;
+    }
+    std::vector<std::pair<size_t, size_t> > ranges;
+    splitRanges(0, count, 0, stopAt, ranges);
+    workers->run((int)ranges.size(), [this, first, base, &ranges](int i) {
+        buildRange(first, ranges[i].first, ranges[i].second, base, 0, -1);
+    });
+    return buildRange(first, 0, count, base, 0, stopAt);
+}
+
+SatIndex SatNet::buildRange(const Sat* sorted, size_t lo, size_t hi, SatIndex base, int depth, int stopAt) {
+    if (lo == hi) {
+        return NOSAT;
+    }
+    size_t middle = lo + (hi - lo) / 2;
+    SatIndex node = base + (SatIndex)middle;
+    if (depth == stopAt) {
+        return node;
+    }
+    m_pool.assign(node, sorted[middle]);
+    SatIndex left = buildRange(sorted, lo, middle, base, depth + 1, stopAt);
+    SatIndex right = buildRange(sorted, middle + 1, hi, base, depth + 1, stopAt);
+    m_pool[node].m_left = left;
+    m_pool[node].m_right = right;
+    updateHeight(node);
     return node;
 }
 
-// COUNT SATELLITES
-int SatNet::countSatellitesRecursive(Sat* node, INCLIN degree) const {
-    if (node == nullptr) {
-        return 0;
+void SatNet::splitRanges(size_t lo, size_t hi, int depth, int stopAt, std::vector<std::pair<size_t, size_t> >& ranges) {
+    if (lo == hi) {
+        return;
+    }
+    if (depth == stopAt) {
+        ranges.push_back(std::make_pair(lo, hi));
+        return;
     }
+    size_t middle = lo + (hi - lo) / 2;
+    splitRanges(lo, middle, depth + 1, stopAt, ranges);
+    splitRanges(middle + 1, hi, depth + 1, stopAt, ranges);
+}
 
-    int count = 0;
-    if (node->getInclin() == degree) {
-        count++;
+void SatNet::indexBatch(const Sat* first, const Sat* last) {
+    for (const Sat* satellite = first; satellite != last; satellite++) {
+        m_index.add(satellite->getID(), satellite->getAlt(), satellite->getInclin(), satellite->getState());
     }
+}
+
+bool SatNet::shouldRebuild(size_t batch) const {
+    return batch >= REBUILDRUN && 8 * batch >= (size_t)m_pool.size();
+}
 
-    count += countSatellitesRecursive(node->getLeft(), degree);
-    count += countSatellitesRecursive(node->getRight(), degree);
+SatLoadReport SatNet::bulkLoad(std::vector<Sat> satellites) {
+    return loadBatch(satellites, nullptr);
+}
 
-    return count;
+SatLoadReport SatNet::bulkLoad(std::vector<Sat> satellites, SatWorkers& workers) {
+    return loadBatch(satellites, &workers);
 }
 
-// COPY TREE
-Sat* SatNet::copyTree(Sat *node) {
-    if (node == nullptr) {
-        return nullptr;
-    }
+SatLoadReport SatNet::bulkMerge(std::vector<Sat> satellites) {
+    return mergeBatch(satellites, nullptr);
+}
 
-    // Create a deep copy of the current node
-    Sat* newSat = new Sat(node->getID(), node->getAlt(), node->getInclin(), node->getState());
-    newSat->setLeft(copyTree(node->getLeft()));
-    newSat->setRight(copyTree(node->getRight()));
+SatLoadReport SatNet::bulkMerge(std::vector<Sat> satellites, SatWorkers& workers) {
+    return mergeBatch(satellites, &workers);
+}
+
+SatLoadReport SatNet::loadBatch(std::vector<Sat>& satellites, SatWorkers* workers) {
+    SatLoadReport report;
+    int kept = prepareBatch(satellites, report, workers);
 
-    return newSat;
+    clear();
+    m_root = buildBalanced(satellites.data(), satellites.data() + kept, workers);
+    indexBatch(satellites.data(), satellites.data() + kept);
+    report.m_loaded = kept;
+    return report;
+}
+
+SatLoadReport SatNet::mergeBatch(std::vector<Sat>& satellites, SatWorkers* workers) {
+    SatLoadReport report;
+    int kept = prepareBatch(satellites, report, workers);
+
+    std::vector<Sat> existing;
+    flatten(existing);
+
+    // merge the two sorted lists, the tree's copy wins on equal IDs
+    std::vector<Sat> merged;
+    merged.reserve(existing.size() + kept);
+    size_t i = 0;
+    int j = 0;
+    while (i < existing.size() || j < kept) {
+        if (j == kept || (i < existing.size() && existing[i].getID() < satellites[j].getID())) {
+            merged.push_back(existing[i++]);
+        } else if (i == existing.size() || satellites[j].getID() < existing[i].getID()) {
+            merged.push_back(satellites[j++]);
+            report.m_loaded++;
+        } else {
+            report.m_duplicates.push_back(satellites[j++].getID());
+        }
+    }
+
+    clear();
+    m_root = buildBalanced(merged.data(), merged.data() + merged.size(), workers);
+    indexBatch(merged.data(), merged.data() + merged.size());
+    return report;
 }
 
 // BASE METHODS
 
 void SatNet::insert(const Sat& satellite){
-    if (satellite.getID() >= MINID && satellite.getID() <= MAXID) {
-        if (!findSatellite(satellite.getID())) {
-            m_root = insertRecursive(m_root, satellite);
-        }
-        else {
-            // throw exception
-            throw std::runtime_error("Satellite already exists (ID: " + std::to_string(satellite.getID()) + ")");
-        }
-    } else {
+    RESULT result = tryInsert(satellite);
+    if (result == DUPLICATE) {
+        // throw exception
+        throw std::runtime_error("Satellite already exists (ID: " + std::to_string(satellite.getID()) + ")");
+    } else if (result == OUT_OF_RANGE) {
         // throw exception
         throw std::runtime_error("Satellite ID out of range (ID: " + std::to_string(satellite.getID()) + ")");
     }
 }
 
+RESULT SatNet::tryInsert(const Sat& satellite){
+    SATTIMER(INSERT);
+    if (satellite.getID() < MINID || satellite.getID() > MAXID) {
+        return OUT_OF_RANGE;
+    }
+    return insertIterative(satellite);
+}
+
 void SatNet::clear(){
-    clearRecursive(m_root);
-    m_root = nullptr;
+    // every node lives in the pool, so there is no need to walk the tree
+    SATSTAT(m_stats.m_frees.add(m_pool.size()));
+    m_pool.reset();
+    m_index.clear();
+    m_root = NOSAT;
 }
 
 void SatNet::remove(int id){
-    if (id >= MINID && id <= MAXID) {
-        if (findSatellite(id)) {
-            removeRecursive(m_root, id);
-        }
+    tryRemove(id);
+}
+
+RESULT SatNet::tryRemove(int id){
+    SATTIMER(REMOVE);
+    if (id < MINID || id > MAXID) {
+        return OUT_OF_RANGE;
     }
+    return removeIterative(id);
 }
 
 void SatNet::dumpTree() const {
-    dump(m_root);
+    SatWriter out(cout);
+    dumpTree(out);
+}
+
+void SatNet::dumpTree(SatWriter& out) const {
+    dump(m_root, out);
+    out.flush();
 }
 
-void SatNet::dump(Sat* satellite) const{
-    if (satellite != nullptr){
-        cout << "(";
-        dump(satellite->m_left);//first visit the left child
-        cout << satellite->m_id << ":" << satellite->m_height;//second visit the node itself
-        dump(satellite->m_right);//third visit the right child
-        cout << ")";
+// each node on the stack remembers how far its visit got
+void SatNet::dump(SatIndex satellite, SatWriter& out) const{
+    SatIndex stack[MAXHEIGHT];
+    int visited[MAXHEIGHT];
+    int depth = 0;
+    if (satellite != NOSAT) {
+        stack[depth] = satellite;
+        visited[depth++] = 0;
+    }
+    while (depth > 0) {
+        const SatNode& node = m_pool[stack[depth - 1]];
+        if (visited[depth - 1] == 0) {
+            out.put('(');
+            visited[depth - 1] = 1;
+            if (node.m_left != NOSAT) {//first visit the left child
+                stack[depth] = node.m_left;
+                visited[depth++] = 0;
+            }
+        } else if (visited[depth - 1] == 1) {
+            out.write((int)node.m_id);//second visit the node itself
+            out.put(':');
+            out.write((int)node.m_height);
+            visited[depth - 1] = 2;
+            if (node.m_right != NOSAT) {//third visit the right child
+                stack[depth] = node.m_right;
+                visited[depth++] = 0;
+            }
+        } else {
+            out.put(')');
+            depth--;
+        }
     }
 }
 
 void SatNet::listSatellites() const {
-    listSatellitesRecursive(m_root);
+    SatWriter out(cout);
+    listSatellites(out);
 }
 
+// only the state counts on the path change, so they are adjusted in place
 bool SatNet::setState(int id, STATE state){
-    return setStateRecursive(m_root, id, state);
+    SATTIMER(SETSTATE);
+    SatIndex path[MAXHEIGHT];
+    int depth = 0;
+    SatIndex node = m_root;
+    while (node != NOSAT && (int)m_pool[node].m_id != id) {
+        path[depth++] = node;
+        node = (id < (int)m_pool[node].m_id) ? m_pool[node].m_left : m_pool[node].m_right;
+    }
+    SATSTAT(m_stats.descent(depth + (node != NOSAT)));
+    if (node == NOSAT) {
+        return false;
+    }
+
+    STATE old = m_pool[node].getState();
+    if (old != state) {
+        m_pool[node].m_state = state;
+        m_index.changeState(id, old, state);
+        path[depth++] = node;
+        for (int i = 0; i < depth; i++) {
+            m_pool.counts(path[i]).m_state[old]--;
+            m_pool.counts(path[i]).m_state[state]++;
+        }
+    }
+    return true;
 }
 
-void SatNet::removeDeorbited(){
-    removeDeorbitedRecursive(m_root);
+int SatNet::removeDeorbited(){
+    return removeIf([](const Sat& satellite) {
+        return satellite.getState() == DEORBITED;
+    });
 }
 
 bool SatNet::findSatellite(int id) const {
-    return findSatelliteRecursive(m_root, id);
+    SATTIMER(FIND);
+    return findNode(id) != NOSAT;
+}
+
+void SatNet::findSatellites(const int* ids, size_t n, bool* out) const {
+    SATBATCHTIMER(FIND, n);
+    descendBatch(ids, n, false, [](size_t, SatIndex) {}, [out](size_t i, SatIndex node) {
+        out[i] = (node != NOSAT);
+    });
+}
+
+// Three passes: an interleaved lookup of every ID, the state changes in batch
+// order (so repeated IDs end in the last state given), then a second
+// interleaved descent that moves the changed satellites between the state
+// counts on their paths. Those adjustments add up the same in any order.
+void SatNet::setStates(const int* ids, const STATE* states, size_t n, bool* out) {
+    SATBATCHTIMER(SETSTATE, n);
+    std::vector<SatIndex> nodes(n);
+    descendBatch(ids, n, false, [](size_t, SatIndex) {}, [&nodes](size_t i, SatIndex node) {
+        nodes[i] = node;
+    });
+
+    std::vector<int> changed;
+    std::vector<STATE> from;
+    std::vector<STATE> to;
+    for (size_t i = 0; i < n; i++) {
+        if (out != nullptr) {
+            out[i] = (nodes[i] != NOSAT);
+        }
+        if (nodes[i] == NOSAT) {
+            continue;
+        }
+        STATE old = m_pool[nodes[i]].getState();
+        if (old != states[i]) {
+            m_pool[nodes[i]].m_state = states[i];
+            m_index.changeState(ids[i], old, states[i]);
+            changed.push_back(ids[i]);
+            from.push_back(old);
+            to.push_back(states[i]);
+        }
+    }
+
+    descendBatch(changed.data(), changed.size(), true, [this, &from, &to](size_t i, SatIndex node) {
+        m_pool.counts(node).m_state[from[i]]--;
+        m_pool.counts(node).m_state[to[i]]++;
+    }, [](size_t, SatIndex) {});
 }
 
 const SatNet & SatNet::operator=(const SatNet & rhs){
@@ -397,15 +1106,171 @@ const SatNet & SatNet::operator=(const SatNet & rhs){
         return *this;
     }
 
-    // Clear the current tree to avoid memory leaks
-    clear();
+    // the node arrays hold the whole tree, so copying them is the deep copy
+    m_pool = rhs.m_pool;
+    m_index = rhs.m_index;
+    m_root = rhs.m_root;
 
-    // Create a deep copy of the rhs tree
-    m_root = copyTree(rhs.m_root);
+    return *this;
+}
 
+// rhs gets this tree's arrays and then empties them, keeping their capacity
+const SatNet & SatNet::operator=(SatNet && rhs) noexcept{
+    if (this != &rhs) {
+        swap(rhs);
+        rhs.clear();
+    }
     return *this;
 }
 
+void SatNet::copyFrom(const SatNet & rhs, SatWorkers& workers){
+    if (this == &rhs) {
+        return;
+    }
+    m_pool.copyFrom(rhs.m_pool, workers);
+    m_index = rhs.m_index;
+    m_root = rhs.m_root;
+}
+
+void SatNet::swap(SatNet & rhs) noexcept{
+    std::swap(m_root, rhs.m_root);
+    std::swap(m_pool, rhs.m_pool);
+    std::swap(m_index, rhs.m_index);
+}
+
+// an empty pool has no NOSAT slot to read the zero counts from
 int SatNet::countSatellites(INCLIN degree) const{
-    return countSatellitesRecursive(m_root, degree);
-}
\ No newline at end of file
+    return (m_root == NOSAT) ? 0 : m_pool.counts(m_root).m_inclin[degree];
+}
+
+int SatNet::countSatellites(ALT altitude) const{
+    return (m_root == NOSAT) ? 0 : m_pool.counts(m_root).m_alt[altitude];
+}
+
+int SatNet::countSatellites(STATE state) const{
+    return (m_root == NOSAT) ? 0 : m_pool.counts(m_root).m_state[state];
+}
+
+int SatNet::countSatellites(INCLIN degree, int minID, int maxID) const{
+    return getCounts(minID, maxID).m_inclin[degree];
+}
+
+int SatNet::countSatellites(ALT altitude, int minID, int maxID) const{
+    return getCounts(minID, maxID).m_alt[altitude];
+}
+
+int SatNet::countSatellites(STATE state, int minID, int maxID) const{
+    return getCounts(minID, maxID).m_state[state];
+}
+
+SatCounts SatNet::getCounts(int minID, int maxID) const{
+    SatCounts counts;
+    if (minID > maxID) {
+        return counts;
+    }
+    // totals for [minID, maxID] are totals up to maxID minus totals below minID
+    countUpTo(maxID, counts);
+    SatCounts below;
+    countUpTo(minID - 1, below);
+    counts.subtract(below);
+    return counts;
+}
+
+// every satellite has exactly one state
+SatIdSet SatNet::getIDs() const{
+    SatIdSet ids = m_index.ids(ACTIVE);
+    ids |= m_index.ids(DEORBITED);
+    ids |= m_index.ids(DECAYING);
+    return ids;
+}
+
+SatSnapshot SatNet::freezeSnapshot() const{
+    std::vector<Sat> sorted;
+    flatten(sorted);
+    return SatSnapshot(sorted);
+}
+
+void SatNet::saveSnapshot(const std::string& path) const{
+    std::vector<Sat> sorted;
+    flatten(sorted);
+    SatImage::save(path, sorted);
+}
+
+// the image is checked in full before the tree is touched, and its records
+// are already sorted and unique, so they go straight to the balanced build
+void SatNet::loadSnapshot(const std::string& path){
+    SatImage image(path);
+    std::vector<Sat> sorted;
+    image.satellites(sorted);
+    clear();
+    m_root = buildBalanced(sorted.data(), sorted.data() + sorted.size(), nullptr);
+    indexBatch(sorted.data(), sorted.data() + sorted.size());
+}
+
+// STATISTICS
+#ifdef SATNET_STATS
+const bool SatNetStats::ENABLED = true;
+#else
+const bool SatNetStats::ENABLED = false;
+#endif
+const int SatNetStats::LATENCYBUCKETS;
+
+void SatNetStats::record(OPERATION operation, uint64_t ns, uint64_t calls){
+    if (calls == 0) {
+        return;
+    }
+    ns /= calls;
+    int bucket = 0;
+    while (bucket < LATENCYBUCKETS - 1 && (ns >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+    m_calls[operation].add(calls);
+    m_latency[operation][bucket].add(calls);
+}
+
+uint64_t SatNetStats::percentileNs(OPERATION operation, double fraction) const{
+    uint64_t calls = 0;
+    for (int b = 0; b < LATENCYBUCKETS; b++) {
+        calls += m_latency[operation][b];
+    }
+    uint64_t seen = 0;
+    for (int b = 0; b < LATENCYBUCKETS; b++) {
+        seen += m_latency[operation][b];
+        if (calls > 0 && seen >= fraction * calls) {
+            return (uint64_t)2 << b;
+        }
+    }
+    return 0;
+}
+
+void SatNetStats::dump(std::ostream& out) const{
+    static const char* const NAMES[NUMOPERATIONS] = {"insert", "remove", "find", "setState"};
+    out << "enabled " << (ENABLED ? 1 : 0) << '\n'
+        << "singleRotations " << m_singleRotations << '\n'
+        << "doubleRotations " << m_doubleRotations << '\n'
+        << "descents " << m_descents << '\n'
+        << "nodesVisited " << m_nodesVisited << '\n'
+        << "longestDescent " << m_longestDescent << '\n'
+        << "allocations " << m_allocations << '\n'
+        << "frees " << m_frees << '\n'
+        << "retraces " << m_retraces << '\n'
+        << "retraceLevels " << m_retraceLevels << '\n'
+        << "deepestRetrace " << m_deepestRetrace << '\n';
+    for (int op = 0; op < NUMOPERATIONS; op++) {
+        out << NAMES[op] << ".calls " << m_calls[op] << '\n'
+            << NAMES[op] << ".p50Ns " << percentileNs((OPERATION)op, 0.5) << '\n'
+            << NAMES[op] << ".p99Ns " << percentileNs((OPERATION)op, 0.99) << '\n';
+    }
+}
+
+SatNetStats SatNet::stats() const{
+#ifdef SATNET_STATS
+    return m_stats;
+#else
+    return SatNetStats();
+#endif
+}
+
+void SatNet::resetStats(){
+    SATSTAT(m_stats.reset());
+}
@@ -1,40 +1,87 @@
 // UMBC - CMSC 341 - Fall 2023 - Proj2
 #ifndef SATNET_H
 #define SATNET_H
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
 #include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
 using namespace std;
 class Grader;//this class is for grading purposes, no need to do anything
 class Tester;//this is your tester class, you add your test functions in this class
 class SatNet;
+class SatSnapshot;
+class ConcurrentSatNet;
+class PersistentSatNet;
+class SatWorkers;
+class SatQuery;
+class SatIterator;
+class SatWriter;
 const int MINID = 10000;
 const int MAXID = 99999;
 enum STATE {ACTIVE, DEORBITED, DECAYING};
 enum ALT {MI208, MI215, MI340, MI350};  // altitude in miles
 enum INCLIN {I48, I53, I70, I97};       // inclination in degrees
+const int NUMSTATES = 3;
+const int NUMALTS = 4;
+const int NUMINCLINS = 4;
+enum RESULT {SUCCESS, DUPLICATE, NOT_FOUND, OUT_OF_RANGE}; // outcome of tryInsert/tryRemove
+enum FORMAT {TEXT, CSV, JSONL};    // line format of listSatellites
 #define DEFAULT_HEIGHT 0
 #define DEFAULT_ID 0
 #define DEFAULT_INCLIN I48
 #define DEFAULT_ALT MI208
 #define DEFAULT_STATE ACTIVE
+// Totals for a set of satellites, one counter per STATE, ALT and INCLIN value.
+// SatNet keeps the totals of every subtree so counts never walk the tree.
+struct SatCounts{
+    int m_state[NUMSTATES];
+    int m_alt[NUMALTS];
+    int m_inclin[NUMINCLINS];
+    SatCounts(){
+        for (int i = 0; i < NUMSTATES; i++) m_state[i] = 0;
+        for (int i = 0; i < NUMALTS; i++) m_alt[i] = 0;
+        for (int i = 0; i < NUMINCLINS; i++) m_inclin[i] = 0;
+    }
+    void add(const SatCounts& rhs){
+        for (int i = 0; i < NUMSTATES; i++) m_state[i] += rhs.m_state[i];
+        for (int i = 0; i < NUMALTS; i++) m_alt[i] += rhs.m_alt[i];
+        for (int i = 0; i < NUMINCLINS; i++) m_inclin[i] += rhs.m_inclin[i];
+    }
+    void subtract(const SatCounts& rhs){
+        for (int i = 0; i < NUMSTATES; i++) m_state[i] -= rhs.m_state[i];
+        for (int i = 0; i < NUMALTS; i++) m_alt[i] -= rhs.m_alt[i];
+        for (int i = 0; i < NUMINCLINS; i++) m_inclin[i] -= rhs.m_inclin[i];
+    }
+    void add(STATE state, ALT alt, INCLIN inclin){
+        m_state[state]++;
+        m_alt[alt]++;
+        m_inclin[inclin]++;
+    }
+    void subtract(STATE state, ALT alt, INCLIN inclin){
+        m_state[state]--;
+        m_alt[alt]--;
+        m_inclin[inclin]--;
+    }
+    int total() const {return m_state[ACTIVE] + m_state[DEORBITED] + m_state[DECAYING];}
+};
+// A satellite's attributes. SatNet links its satellites through SatNode
+// records, so a Sat carries no child links or height of its own.
 class Sat{
 public:
     friend class SatNet;
     friend class Grader;
     friend class Tester;
     Sat(int id, ALT alt=DEFAULT_ALT, INCLIN inclin = DEFAULT_INCLIN, STATE state = DEFAULT_STATE)
-            :m_id(id),m_altitude(alt), m_inclin(inclin), m_state(state) {
-        m_left = nullptr;
-        m_right = nullptr;
-        m_height = DEFAULT_HEIGHT;
-    }
+            :m_id(id),m_altitude(alt), m_inclin(inclin), m_state(state) {}
     Sat(){
         m_id = DEFAULT_ID;
         m_altitude = DEFAULT_ALT;
         m_inclin = DEFAULT_INCLIN;
         m_state = DEFAULT_STATE;
-        m_left = nullptr;
-        m_right = nullptr;
-        m_height = DEFAULT_HEIGHT;
     }
     int getID() const {return m_id;}
     STATE getState() const {return m_state;}
@@ -72,97 +119,465 @@ public:
         }
         return text;
     }
-    int getHeight() const {return m_height;}
-    Sat* getLeft() const {return m_left;}
-    Sat* getRight() const {return m_right;}
     void setID(const int id){m_id=id;}
     void setState(STATE state){m_state=state;}
     void setInclin(INCLIN degree){m_inclin=degree;}
     void setAlt(ALT altitude){m_altitude=altitude;}
-    void setHeight(int height){m_height=height;}
-    void setLeft(Sat* left){m_left=left;}
-    void setRight(Sat* right){m_right=right;}
 private:
     int m_id;
     ALT m_altitude;
     INCLIN m_inclin;
     STATE m_state;
-    Sat* m_left;    //the pointer to the left child in the BST
-    Sat* m_right;   //the pointer to the right child in the BST
-    int m_height;   //the height of node in the BST
+};
+// Index of a node in a SatPool. Index 0 is the empty subtree: it has height 0
+// and zero counts, so tree code can read through it without null checks.
+typedef uint32_t SatIndex;
+const SatIndex NOSAT = 0;
+// A tree node as SatNet stores it: 12 bytes instead of the 40 of a Sat that
+// carried its own child pointers and height, so the nodes of a full fleet
+// of 90,000 take about 1 MB. The 44-byte subtree counts (about 4 MB more)
+// are only touched on updates and range counts, so they live apart from it.
+struct SatNode{
+    SatIndex m_left;        //index of the left child in the BST
+    SatIndex m_right;       //index of the right child in the BST
+    unsigned m_id : 17;     //MAXID fits in 17 bits
+    unsigned m_height : 5;  //the height of node in the BST
+    unsigned m_alt : 2;
+    unsigned m_inclin : 2;
+    unsigned m_state : 2;
+    ALT getAlt() const {return (ALT)m_alt;}
+    INCLIN getInclin() const {return (INCLIN)m_inclin;}
+    STATE getState() const {return (STATE)m_state;}
+};
+// Node storage for a SatNet: one contiguous array of SatNode, with the cold
+// subtree counts in a parallel array. Children are 32-bit indices, so the
+// arrays can grow without invalidating links and the whole tree is copied
+// with two array copies. Released nodes are recycled through a free list
+// threaded through m_left.
+class SatPool{
+public:
+    SatPool();
+    SatIndex allocate(const Sat& satellite);
+    // n fresh nodes at consecutive indices, returns the first; fill them with assign
+    SatIndex allocateRange(int n);
+    // stores satellite in node as a leaf
+    void assign(SatIndex node, const Sat& satellite);
+    void release(SatIndex node);
+    // make sure n more nodes can be handed out without the arrays moving
+    void reserve(int n);
+    // release every node at once, the arrays keep their capacity; never allocates
+    void reset();
+    // the same as operator=, with the arrays copied in slices across workers
+    void copyFrom(const SatPool& rhs, SatWorkers& workers);
+    int size() const {return m_live;}
+    SatNode& operator[](SatIndex node) {return m_nodes[node];}
+    const SatNode& operator[](SatIndex node) const {return m_nodes[node];}
+    SatCounts& counts(SatIndex node) {return m_counts[node];}
+    const SatCounts& counts(SatIndex node) const {return m_counts[node];}
+    // the node as a Sat value, for callers outside the tree
+    Sat satellite(SatIndex node) const;
+private:
+    std::vector<SatNode> m_nodes;       // m_nodes[NOSAT] is the empty subtree, once there is a node
+    std::vector<SatCounts> m_counts;    // subtree totals, parallel to m_nodes
+    SatIndex m_freeList;                // released nodes, linked through m_left
+    int m_live;                         // number of nodes handed out
+
+    // gives an empty pool its NOSAT slot, with room for that many nodes after it
+    void addSentinel(size_t room);
+};
+// Outcome of SatNet::bulkLoad and SatNet::bulkMerge
+struct SatLoadReport{
+    int m_loaded;                   // satellites added to the tree
+    std::vector<int> m_duplicates;  // IDs already in the tree or repeated in the batch
+    std::vector<int> m_outOfRange;  // IDs outside [MINID, MAXID]
+    SatLoadReport() : m_loaded(0) {}
+};
+// One counter of SatNetStats. Increments are a relaxed atomic load and
+// store rather than a locked add: threads reading one SatNet at once (the
+// readers of a ConcurrentSatNet) may lose an occasional count but never race.
+class SatStat{
+public:
+    SatStat(uint64_t value = 0) : m_value(value) {}
+    SatStat(const SatStat& rhs) : m_value(rhs.get()) {}
+    SatStat& operator=(const SatStat& rhs) {m_value.store(rhs.get(), std::memory_order_relaxed); return *this;}
+    operator uint64_t() const {return get();}
+    uint64_t get() const {return m_value.load(std::memory_order_relaxed);}
+    void add(uint64_t n) {m_value.store(get() + n, std::memory_order_relaxed);}
+    // keeps the larger of the value and n
+    void raise(uint64_t n) {if (n > get()) m_value.store(n, std::memory_order_relaxed);}
+private:
+    std::atomic<uint64_t> m_value;
+};
+// Hot-path counters of one SatNet, returned by SatNet::stats(). They are only
+// kept when every file is compiled with -DSATNET_STATS; otherwise SatNet has
+// no counters, the hooks compile to nothing and stats() is all zeros. The
+// counters start at zero for every SatNet, copies included.
+struct SatNetStats{
+    enum OPERATION {INSERT, REMOVE, FIND, SETSTATE, NUMOPERATIONS};
+    // latency bucket b counts the calls that took [2^b, 2^(b+1)) ns
+    static const int LATENCYBUCKETS = 32;
+    static const bool ENABLED;          // built with SATNET_STATS
+    SatStat m_singleRotations;          // LL and RR cases of balance
+    SatStat m_doubleRotations;          // LR and RL cases
+    SatStat m_descents;                 // root-to-node walks by insert, remove, find and setState, batches included
+    SatStat m_nodesVisited;             // nodes those walks looked at
+    SatStat m_longestDescent;
+    SatStat m_allocations;              // nodes taken from the pool, by inserts and builds
+    SatStat m_frees;                    // nodes given back, by removes, removeIf, clear and rebuilds
+    SatStat m_retraces;                 // bottom-up passes after an insert or remove
+    SatStat m_retraceLevels;            // levels those passes rebalanced
+    SatStat m_deepestRetrace;
+    SatStat m_calls[NUMOPERATIONS];     // public calls, one per ID of a batch, with their latencies below
+    SatStat m_latency[NUMOPERATIONS][LATENCYBUCKETS];
+    void reset() {*this = SatNetStats();}
+    // calls > 1 is a batch, counted as that many calls of its mean latency
+    void record(OPERATION operation, uint64_t ns, uint64_t calls = 1);
+    void descent(uint64_t nodes) {m_descents.add(1); m_nodesVisited.add(nodes); m_longestDescent.raise(nodes);}
+    // the upper bound of the bucket that holds the given fraction of the
+    // calls, in ns; 0 if there were none
+    uint64_t percentileNs(OPERATION operation, double fraction) const;
+    // one "name value" line per counter, and per operation its calls and p50/p99
+    void dump(std::ostream& out) const;
+};
+// A set of satellite IDs, one bit per possible ID in [MINID, MAXID]. Sets
+// combine word by word, so intersecting or joining two of them costs about
+// 1,400 word operations whatever the fleet size. An empty set holds no words;
+// the bitmap (about 11 KB) is allocated with the first ID.
+class SatIdSet{
+public:
+    SatIdSet() {}
+    void insert(int id);
+    void erase(int id);
+    bool contains(int id) const;
+    bool empty() const;
+    int size() const;
+    // releases the bitmap
+    void clear();
+    SatIdSet& operator&=(const SatIdSet& rhs);
+    SatIdSet& operator|=(const SatIdSet& rhs);
+    // removes the IDs of rhs
+    SatIdSet& operator-=(const SatIdSet& rhs);
+    bool operator==(const SatIdSet& rhs) const;
+    bool operator!=(const SatIdSet& rhs) const {return !(*this == rhs);}
+    // the IDs in increasing order
+    std::vector<int> ids() const;
+    // calls visit(id) for every ID in increasing order
+    template <class Visit>
+    void forEach(Visit visit) const;
+private:
+    static const int WORDBITS = 64;
+    static const int NUMWORDS = (MAXID - MINID + WORDBITS) / WORDBITS;
+    std::vector<uint64_t> m_words;  // empty, or NUMWORDS words with bit (id - MINID) set for each id
+};
+
+inline SatIdSet operator&(SatIdSet lhs, const SatIdSet& rhs) {return lhs &= rhs;}
+inline SatIdSet operator|(SatIdSet lhs, const SatIdSet& rhs) {return lhs |= rhs;}
+inline SatIdSet operator-(SatIdSet lhs, const SatIdSet& rhs) {return lhs -= rhs;}
+
+template <class Visit>
+void SatIdSet::forEach(Visit visit) const{
+    for (size_t w = 0; w < m_words.size(); w++) {
+        uint64_t bits = m_words[w];
+        while (bits != 0) {
+            visit(MINID + (int)w * WORDBITS + __builtin_ctzll(bits));
+            bits &= bits - 1;
+        }
+    }
+}
+
+// The IDs of a SatNet's satellites by state, altitude and inclination. SatNet
+// updates it on every insert, remove and state change, so enumerating or
+// counting by attribute never walks the tree.
+class SatAttrIndex{
+public:
+    void add(int id, ALT alt, INCLIN inclin, STATE state);
+    void remove(int id, ALT alt, INCLIN inclin, STATE state);
+    void changeState(int id, STATE from, STATE to);
+    void clear();
+    const SatIdSet& ids(STATE state) const {return m_state[state];}
+    const SatIdSet& ids(ALT altitude) const {return m_alt[altitude];}
+    const SatIdSet& ids(INCLIN degree) const {return m_inclin[degree];}
+private:
+    SatIdSet m_state[NUMSTATES];
+    SatIdSet m_alt[NUMALTS];
+    SatIdSet m_inclin[NUMINCLINS];
 };
 class SatNet{
 public:
     friend class Grader;
     friend class Tester;
+    friend class ConcurrentSatNet;
+    friend class PersistentSatNet;
+    friend class SatQuery;
+    friend class SatIterator;
+    typedef SatIterator const_iterator;
+    typedef SatIterator iterator;
     SatNet();
+    // copies the node arrays as they are, heights and counts included
+    SatNet(const SatNet & rhs);
+    // takes over rhs's nodes in O(1) and leaves rhs empty; an empty tree owns
+    // no memory, so this never allocates
+    SatNet(SatNet && rhs) noexcept;
     ~SatNet();
     // overloaded assignment operator
     const SatNet & operator=(const SatNet & rhs);
+    // O(1), leaves rhs empty
+    const SatNet & operator=(SatNet && rhs) noexcept;
+    // exchanges the two fleets in O(1)
+    void swap(SatNet & rhs) noexcept;
     void insert(const Sat& satellite);
+    // insert without exceptions, a single descent finds the slot or the duplicate
+    RESULT tryInsert(const Sat& satellite);
+    // replaces the tree with a balanced tree built from the batch in O(n log n)
+    // for the sort and O(n) for the build; the first of repeated IDs is kept
+    SatLoadReport bulkLoad(std::vector<Sat> satellites);
+    // adds the batch to the tree, rebuilding it balanced in O(n + m log m);
+    // satellites already in the tree win over the batch
+    SatLoadReport bulkMerge(std::vector<Sat> satellites);
+    // the same, with the sort and the build split across workers
+    SatLoadReport bulkLoad(std::vector<Sat> satellites, SatWorkers& workers);
+    SatLoadReport bulkMerge(std::vector<Sat> satellites, SatWorkers& workers);
+    // true if a batch of that many new or removed satellites is cheaper as one
+    // rebuild (bulkMerge, removeIf) than as one descent each: at least
+    // REBUILDRUN of them, and at least an eighth of the fleet
+    bool shouldRebuild(size_t batch) const;
+    // operator=, with the node arrays copied across workers
+    void copyFrom(const SatNet & rhs, SatWorkers& workers);
     void clear();
     void remove(int id);
+    // remove without exceptions, a single descent finds the node or reports NOT_FOUND
+    RESULT tryRemove(int id);
     void dumpTree() const;
     void listSatellites() const;
+    // the same, buffered into out and flushed once at the end; CSV starts
+    // with a header line, JSONL writes one object per satellite
+    void dumpTree(SatWriter& out) const;
+    void listSatellites(SatWriter& out, FORMAT format = TEXT) const;
     bool setState(int id, STATE state);
-    void removeDeorbited();//removes all deorbited satellites from the tree
+    int removeDeorbited();//removes all deorbited satellites from the tree, returns how many
+    // removes every satellite the predicate (bool(const Sat&)) holds for and
+    // rebuilds the tree from the survivors in O(n), returns how many went
+    template <class Predicate>
+    int removeIf(Predicate predicate);
     bool findSatellite(int id) const; //returns true if the satellite is in tree
+    // out[i] = findSatellite(ids[i]); the descents run interleaved, so their
+    // cache misses overlap instead of queueing one behind the other
+    void findSatellites(const int* ids, size_t n, bool* out) const;
+    // out[i] = setState(ids[i], states[i]), applied in order; out may be null
+    void setStates(const int* ids, const STATE* states, size_t n, bool* out);
     int countSatellites(INCLIN degree) const;
+    int countSatellites(ALT altitude) const;
+    int countSatellites(STATE state) const;
+    // counts restricted to IDs in [minID, maxID], O(log n)
+    int countSatellites(INCLIN degree, int minID, int maxID) const;
+    int countSatellites(ALT altitude, int minID, int maxID) const;
+    int countSatellites(STATE state, int minID, int maxID) const;
+    // all totals for IDs in [minID, maxID]
+    SatCounts getCounts(int minID = MINID, int maxID = MAXID) const;
+    // immutable lookup copy of the fleet for read-heavy callers, O(n)
+    SatSnapshot freezeSnapshot() const;
+    // writes the fleet to path in the binary SatImage format, replacing the
+    // file in one rename; throws std::runtime_error if it cannot be written
+    void saveSnapshot(const std::string& path) const;
+    // replaces the tree with the fleet saved at path, built balanced in O(n)
+    // from the mapped file; throws std::runtime_error and keeps the tree as
+    // it was if the file is missing or damaged
+    void loadSnapshot(const std::string& path);
+    // the IDs of the satellites with the given attribute, from the attribute
+    // index; combine them with &, | and -, e.g. getIDs(DECAYING) & getIDs(MI340)
+    const SatIdSet& getIDs(STATE state) const {return m_index.ids(state);}
+    const SatIdSet& getIDs(ALT altitude) const {return m_index.ids(altitude);}
+    const SatIdSet& getIDs(INCLIN degree) const {return m_index.ids(degree);}
+    // the IDs of every satellite in the tree
+    SatIdSet getIDs() const;
+    // in-order iteration by ID; any change to the tree invalidates iterators
+    const_iterator begin() const;
+    const_iterator end() const;
+    // the first satellite with ID >= id, or end(), O(log n)
+    const_iterator lower_bound(int id) const;
+    // the first satellite with ID > id, or end(), O(log n)
+    const_iterator upper_bound(int id) const;
+    std::pair<const_iterator, const_iterator> equal_range(int id) const;
+    // calls visit(const Sat&) for every satellite with ID in [minID, maxID] in
+    // ID order, entering only the subtrees that overlap the range: O(log n + k)
+    template <class Visit>
+    void forEachInRange(int minID, int maxID, Visit visit) const;
+    // the counters kept since construction or resetStats(); all zeros
+    // unless built with SATNET_STATS
+    SatNetStats stats() const;
+    void resetStats();
     //helper functions
-    static int getBalance(Sat* node);
-    Sat* getRoot() const;
-    bool getBSTValidity(Sat* node, int min = MINID, int max = MAXID) const;
+    int getBalance(SatIndex node) const;
+    SatIndex getRoot() const;
+    bool getBSTValidity(SatIndex node, int min = MINID, int max = MAXID) const;
 
 private:
-    Sat* m_root;    //the root of the BST
-    //helper for recursive traversal
-    void dump(Sat* satellite) const;
+    // an AVL tree of MAXID - MINID + 1 nodes is at most 24 levels high,
+    // so fixed-size stacks of this depth replace recursion
+    static const int MAXHEIGHT = 32;
+
+    SatIndex m_root;    //the root of the BST
+    SatPool m_pool;     //owns every node in the tree
+    SatAttrIndex m_index;   //the IDs by attribute, kept in step with the tree
+#ifdef SATNET_STATS
+    mutable SatNetStats m_stats;    //written by const lookups too
+#endif
+    //helper for traversal
+    void dump(SatIndex satellite, SatWriter& out) const;
 
     // helpers for insertion
     // rotations
     // Right rotation
-    static Sat* rightRotate(Sat* node);
+    SatIndex rightRotate(SatIndex node);
 
     // Left rotation
-    static Sat* leftRotate(Sat* node);
+    SatIndex leftRotate(SatIndex node);
 
-    // Helper function to update the height of a node
-    static void updateHeight(Sat* node);
+    // Helper function to update the height and subtree counts of a node
+    void updateHeight(SatIndex node);
 
     // Helper function to balance the AVL tree
-    static Sat* balance(Sat* node);
+    SatIndex balance(SatIndex node);
 
     // insertion
-    Sat* insertRecursive(Sat* node, const Sat& satellite);
+    RESULT insertIterative(const Sat& satellite);
 
-    // clear nodes and delete root
-    void clearRecursive(Sat* node);
+    // rebalance the links in path[0..depth) bottom-up after an insert or removal
+    void retrace(SatIndex* path[], int depth, int split, const Sat& above, const Sat& below, bool added);
 
     // removal
-    Sat* removeRecursive(Sat* node, int id);
+    RESULT removeIterative(int id);
 
-    // find min: for removal
-    static Sat* findMin(Sat* node);
+    // find satellite: the node holding id, or NOSAT
+    SatIndex findNode(int id) const;
+    // batched find: for every i, calls step(i, node) on each node of the path to
+    // ids[i] and then visit(i, findNode(ids[i])); the i are handled in no
+    // particular order. withCounts prefetches the subtree counts along the way.
+    static const int BATCHLANES = 16;
+    template <class Step, class Visit>
+    void descendBatch(const int* ids, size_t n, bool withCounts, Step step, Visit visit) const;
 
-    // find satellite
-    bool findSatelliteRecursive(Sat* node, int id) const;
+    // removeIf: in-order list of the tree's nodes
+    void flattenNodes(std::vector<SatIndex>& nodes) const;
+    // takes the node out of the index, gives it back to the pool and counts
+    // the free; not a template, so the SATNET_STATS hooks reach it
+    void releaseNode(SatIndex node);
+    // links the sorted nodes [first, last) into a balanced subtree, without allocating
+    SatIndex linkBalanced(const SatIndex* first, const SatIndex* last);
 
-    // set state
-    bool setStateRecursive(Sat* node, int id, STATE state);
+    // count satellites: adds the totals of every node with ID <= maxID to counts
+    void countUpTo(int maxID, SatCounts& counts) const;
 
-    // list satellites
-    void listSatellitesRecursive(Sat* node) const;
+    // bulk loading; workers may be null, which keeps everything on this thread
+    // batches smaller than this are not worth splitting across threads
+    static const int PARALLELMIN = 4096;
+    // smaller batches never pay for a rebuild, see shouldRebuild
+    static const size_t REBUILDRUN = 1024;
+    SatLoadReport loadBatch(std::vector<Sat>& satellites, SatWorkers* workers);
+    SatLoadReport mergeBatch(std::vector<Sat>& satellites, SatWorkers* workers);
+    // stable sort by ID: sorted slices, then rounds of pairwise merges
+    static void sortBatch(std::vector<Sat>& satellites, SatWorkers* workers);
+    // sorts the batch, moves valid unique satellites to the front and returns how many
+    static int prepareBatch(std::vector<Sat>& satellites, SatLoadReport& report, SatWorkers* workers);
+    // adds the sorted satellites [first, last) to the attribute index
+    void indexBatch(const Sat* first, const Sat* last);
+    // in-order copy of the tree's satellites
+    void flatten(std::vector<Sat>& satellites) const;
+    // builds a balanced tree from the sorted range [first, last) in fresh nodes
+    SatIndex buildBalanced(const Sat* first, const Sat* last, SatWorkers* workers);
+    // builds sorted[lo, hi) as a subtree in nodes base + lo .. base + hi - 1;
+    // subtrees at depth stopAt are taken as built and only linked (-1: none)
+    SatIndex buildRange(const Sat* sorted, size_t lo, size_t hi, SatIndex base, int depth, int stopAt);
+    // the ranges buildRange reaches at depth stopAt
+    static void splitRanges(size_t lo, size_t hi, int depth, int stopAt, std::vector<std::pair<size_t, size_t> >& ranges);
+};
 
-    // remove deorbited
-    Sat* removeDeorbitedRecursive(Sat* node);
+// A bidirectional iterator over a SatNet in ID order. There are no parent
+// links, so it carries the path from the root to its node; end() is the empty
+// path, and stepping back from it goes to the largest ID. Dereferencing
+// gives the satellite by value, as a Sat built from the compact node.
+class SatIterator{
+public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef Sat value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Sat reference;
+    // holds the satellite for operator->, since there is no Sat in the tree to point at
+    struct pointer{
+        Sat m_satellite;
+        const Sat* operator->() const {return &m_satellite;}
+    };
+    SatIterator() : m_pool(nullptr), m_root(NOSAT), m_depth(0) {}
+    Sat operator*() const {return m_pool->satellite(m_path[m_depth - 1]);}
+    pointer operator->() const {pointer p = {**this}; return p;}
+    int getID() const {return (*m_pool)[m_path[m_depth - 1]].m_id;}
+    SatIterator& operator++();
+    SatIterator& operator--();
+    SatIterator operator++(int) {SatIterator old = *this; ++*this; return old;}
+    SatIterator operator--(int) {SatIterator old = *this; --*this; return old;}
+    bool operator==(const SatIterator& rhs) const;
+    bool operator!=(const SatIterator& rhs) const {return !(*this == rhs);}
+private:
+    friend class SatNet;
+    const SatPool* m_pool;
+    SatIndex m_root;
+    SatIndex m_path[SatNet::MAXHEIGHT];  // m_path[0] is the root, m_path[m_depth - 1] the current node
+    int m_depth;                         // 0 at end()
+    SatIterator(const SatPool* pool, SatIndex root) : m_pool(pool), m_root(root), m_depth(0) {}
+    // pushes node and its left spine (descendLeft) or right spine
+    void pushSpine(SatIndex node, bool descendLeft);
+};
 
-    // removeNode: helper for removeDeorbited
-    Sat* removeNode(Sat* node);
+inline void swap(SatNet & lhs, SatNet & rhs) noexcept {
+    lhs.swap(rhs);
+}
 
-    // count satellites
-    int countSatellitesRecursive(Sat* node, INCLIN degree) const;
+// in-order walk with an explicit stack that skips the children the range rules
+// out: a node below minID has nothing of interest on its left, one above
+// maxID nothing on its right
+template <class Visit>
+void SatNet::forEachInRange(int minID, int maxID, Visit visit) const{
+    SatIndex stack[MAXHEIGHT];
+    int depth = 0;
+    SatIndex node = m_root;
+    while (node != NOSAT || depth > 0) {
+        while (node != NOSAT) {
+            stack[depth++] = node;
+            node = ((int)m_pool[node].m_id > minID) ? m_pool[node].m_left : NOSAT;
+        }
+        node = stack[--depth];
+        int id = m_pool[node].m_id;
+        if (id > maxID) {
+            // everything still on the stack is larger again
+            return;
+        }
+        if (id >= minID) {
+            visit(m_pool.satellite(node));
+        }
+        node = m_pool[node].m_right;
+    }
+}
 
-    // copy tree
-    Sat* copyTree(Sat* node);
-};
-#endif
\ No newline at end of file
+// the nodes are visited in order and the survivors are kept in order, so they
+// can be linked straight back into a balanced tree
+template <class Predicate>
+int SatNet::removeIf(Predicate predicate){
+    std::vector<SatIndex> nodes;
+    flattenNodes(nodes);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (predicate(m_pool.satellite(nodes[i]))) {
+            releaseNode(nodes[i]);
+        } else {
+            nodes[kept++] = nodes[i];
+        }
+    }
+
+    int removed = (int)(nodes.size() - kept);
+    if (removed > 0) {
+        m_root = linkBalanced(nodes.data(), nodes.data() + kept);
+    }
+    return removed;
+}
+#endif
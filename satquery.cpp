@@ -0,0 +1,170 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#include "satquery.h"
+#include "satworkers.h"
+
+SatFilter SatFilter::state(STATE state){
+    return where([state](ALT, INCLIN, STATE s) {
+        return s == state;
+    });
+}
+
+SatFilter SatFilter::alt(ALT altitude){
+    return where([altitude](ALT a, INCLIN, STATE) {
+        return a == altitude;
+    });
+}
+
+SatFilter SatFilter::inclin(INCLIN degree){
+    return where([degree](ALT, INCLIN i, STATE) {
+        return i == degree;
+    });
+}
+
+int SatHistogram::count(const SatFilter& filter) const {
+    int total = 0;
+    for (int a = 0; a < NUMALTS; a++) {
+        for (int i = 0; i < NUMINCLINS; i++) {
+            for (int s = 0; s < NUMSTATES; s++) {
+                if (filter.matches((ALT)a, (INCLIN)i, (STATE)s)) {
+                    total += count((ALT)a, (INCLIN)i, (STATE)s);
+                }
+            }
+        }
+    }
+    return total;
+}
+
+SatCounts SatHistogram::totals() const {
+    SatCounts counts;
+    for (int a = 0; a < NUMALTS; a++) {
+        for (int i = 0; i < NUMINCLINS; i++) {
+            for (int s = 0; s < NUMSTATES; s++) {
+                int n = count((ALT)a, (INCLIN)i, (STATE)s);
+                counts.m_alt[a] += n;
+                counts.m_inclin[i] += n;
+                counts.m_state[s] += n;
+            }
+        }
+    }
+    return counts;
+}
+
+SatQuery::SatQuery(const SatNet& satNet, SatWorkers& workers)
+        : m_satNet(satNet), m_workers(workers) {
+}
+
+// SPLITTING
+// A few pieces per thread, as in SatNet::buildBalanced, so the shared task
+// counter can even out subtrees that the ID range cuts into unequal parts.
+void SatQuery::split(int minID, int maxID, std::vector<Piece>& pieces) const {
+    int stopAt = 0;
+    if (m_workers.threads() > 1 && m_satNet.m_pool.size() >= SatNet::PARALLELMIN) {
+        while ((1 << stopAt) < 4 * m_workers.threads()) {
+            stopAt++;
+        }
+    }
+    splitAt(m_satNet.m_root, 0, stopAt, minID, maxID, pieces);
+}
+
+void SatQuery::splitAt(SatIndex node, int depth, int stopAt, int minID, int maxID, std::vector<Piece>& pieces) const {
+    if (node == NOSAT) {
+        return;
+    }
+    if (depth == stopAt) {
+        Piece piece = {node, false};
+        pieces.push_back(piece);
+        return;
+    }
+    const SatNode& satellite = m_satNet.m_pool[node];
+    int id = satellite.m_id;
+    if (id > minID) {
+        splitAt(satellite.m_left, depth + 1, stopAt, minID, maxID, pieces);
+    }
+    if (id >= minID && id <= maxID) {
+        Piece piece = {node, true};
+        pieces.push_back(piece);
+    }
+    if (id < maxID) {
+        splitAt(satellite.m_right, depth + 1, stopAt, minID, maxID, pieces);
+    }
+}
+
+// in-order walk with an explicit stack, skipping the children the range rules out
+template <class Visit>
+void SatQuery::walk(const Piece& piece, int minID, int maxID, Visit visit) const {
+    const SatPool& pool = m_satNet.m_pool;
+    if (piece.m_single) {
+        visit(pool[piece.m_node]);
+        return;
+    }
+    SatIndex stack[SatNet::MAXHEIGHT];
+    int depth = 0;
+    SatIndex node = piece.m_node;
+    while (node != NOSAT || depth > 0) {
+        while (node != NOSAT) {
+            stack[depth++] = node;
+            node = ((int)pool[node].m_id > minID) ? pool[node].m_left : NOSAT;
+        }
+        const SatNode& satellite = pool[stack[--depth]];
+        int id = satellite.m_id;
+        if (id >= minID && id <= maxID) {
+            visit(satellite);
+        }
+        node = (id < maxID) ? satellite.m_right : NOSAT;
+    }
+}
+
+// QUERIES
+
+SatHistogram SatQuery::histogram(int minID, int maxID) const {
+    SatHistogram histogram;
+    if (minID > maxID) {
+        return histogram;
+    }
+    std::vector<Piece> pieces;
+    split(minID, maxID, pieces);
+    std::vector<SatHistogram> partials(pieces.size());
+    m_workers.run((int)pieces.size(), [this, &pieces, &partials, minID, maxID](int i) {
+        // counted on the stack, so threads do not share cache lines while counting
+        SatHistogram partial;
+        walk(pieces[i], minID, maxID, [&partial](const SatNode& satellite) {
+            partial.m_cells[SatFilter::cell(satellite.getAlt(), satellite.getInclin(), satellite.getState())]++;
+        });
+        partials[i] = partial;
+    });
+    for (size_t i = 0; i < partials.size(); i++) {
+        histogram.add(partials[i]);
+    }
+    return histogram;
+}
+
+int SatQuery::count(const SatFilter& filter, int minID, int maxID) const {
+    return histogram(minID, maxID).count(filter);
+}
+
+std::vector<int> SatQuery::findIDs(const SatFilter& filter, int minID, int maxID) const {
+    std::vector<int> ids;
+    if (minID > maxID) {
+        return ids;
+    }
+    std::vector<Piece> pieces;
+    split(minID, maxID, pieces);
+    std::vector<std::vector<int> > partials(pieces.size());
+    m_workers.run((int)pieces.size(), [this, &pieces, &partials, &filter, minID, maxID](int i) {
+        std::vector<int>& partial = partials[i];
+        walk(pieces[i], minID, maxID, [&partial, &filter](const SatNode& satellite) {
+            if (filter.matches(satellite.getAlt(), satellite.getInclin(), satellite.getState())) {
+                partial.push_back(satellite.m_id);
+            }
+        });
+    });
+    size_t total = 0;
+    for (size_t i = 0; i < partials.size(); i++) {
+        total += partials[i].size();
+    }
+    ids.reserve(total);
+    for (size_t i = 0; i < partials.size(); i++) {
+        ids.insert(ids.end(), partials[i].begin(), partials[i].end());
+    }
+    return ids;
+}
@@ -0,0 +1,102 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#ifndef SATQUERY_H
+#define SATQUERY_H
+#include "satnet.h"
+#include <cstdint>
+#include <vector>
+// A set of ALT x INCLIN x STATE combinations, one bit per combination. Every
+// predicate on a satellite's attributes is such a set, so filters combine with
+// &, | and ~ and are checked with a single mask test per satellite.
+class SatFilter{
+public:
+    static const int NUMCELLS = NUMALTS * NUMINCLINS * NUMSTATES;
+    // matches every satellite
+    SatFilter() : m_cells(ALLCELLS) {}
+    static SatFilter none() {return SatFilter(0);}
+    static SatFilter state(STATE state);
+    static SatFilter alt(ALT altitude);
+    static SatFilter inclin(INCLIN degree);
+    // the combinations the predicate (bool(ALT, INCLIN, STATE)) holds for
+    template <class Predicate>
+    static SatFilter where(Predicate predicate);
+    SatFilter operator&(const SatFilter& rhs) const {return SatFilter(m_cells & rhs.m_cells);}
+    SatFilter operator|(const SatFilter& rhs) const {return SatFilter(m_cells | rhs.m_cells);}
+    SatFilter operator~() const {return SatFilter(~m_cells & ALLCELLS);}
+    bool matches(ALT alt, INCLIN inclin, STATE state) const {return (m_cells >> cell(alt, inclin, state)) & 1;}
+    static int cell(ALT alt, INCLIN inclin, STATE state) {return (alt * NUMINCLINS + inclin) * NUMSTATES + state;}
+
+private:
+    static const uint64_t ALLCELLS = (uint64_t(1) << NUMCELLS) - 1;
+    uint64_t m_cells;   // bit cell(alt, inclin, state) is set if the combination matches
+    explicit SatFilter(uint64_t cells) : m_cells(cells) {}
+};
+
+template <class Predicate>
+SatFilter SatFilter::where(Predicate predicate){
+    uint64_t cells = 0;
+    for (int a = 0; a < NUMALTS; a++) {
+        for (int i = 0; i < NUMINCLINS; i++) {
+            for (int s = 0; s < NUMSTATES; s++) {
+                if (predicate((ALT)a, (INCLIN)i, (STATE)s)) {
+                    cells |= uint64_t(1) << cell((ALT)a, (INCLIN)i, (STATE)s);
+                }
+            }
+        }
+    }
+    return SatFilter(cells);
+}
+
+// Satellite counts for every ALT x INCLIN x STATE combination. The subtree
+// totals SatNet keeps count each attribute on its own; this is the joint
+// breakdown, which takes a pass over the satellites.
+struct SatHistogram{
+    int m_cells[SatFilter::NUMCELLS];
+    SatHistogram(){
+        for (int i = 0; i < SatFilter::NUMCELLS; i++) m_cells[i] = 0;
+    }
+    void add(const SatHistogram& rhs){
+        for (int i = 0; i < SatFilter::NUMCELLS; i++) m_cells[i] += rhs.m_cells[i];
+    }
+    int count(ALT alt, INCLIN inclin, STATE state) const {return m_cells[SatFilter::cell(alt, inclin, state)];}
+    // satellites in the combinations the filter matches
+    int count(const SatFilter& filter) const;
+    int total() const {return count(SatFilter());}
+    // the per-attribute totals, as SatNet::getCounts gives them
+    SatCounts totals() const;
+};
+
+// Fleet-wide reports over a SatNet, split across SatWorkers. The tree is cut
+// a few levels below the root into a list of subtrees and single nodes in ID
+// order; each task walks one piece into its own partial result, and the
+// partials are merged in order, so matching IDs come out sorted. Subtrees
+// wholly outside [minID, maxID] are never entered. The SatNet must not change
+// while a query runs.
+class SatQuery{
+public:
+    friend class Grader;
+    friend class Tester;
+    SatQuery(const SatNet& satNet, SatWorkers& workers);
+    // the joint breakdown of the satellites with IDs in [minID, maxID]
+    SatHistogram histogram(int minID = MINID, int maxID = MAXID) const;
+    // how many satellites with IDs in [minID, maxID] the filter matches
+    int count(const SatFilter& filter, int minID = MINID, int maxID = MAXID) const;
+    // the IDs in [minID, maxID] the filter matches, in increasing order
+    std::vector<int> findIDs(const SatFilter& filter, int minID = MINID, int maxID = MAXID) const;
+
+private:
+    // a unit of work: a whole subtree, or a single node above the cut
+    struct Piece{
+        SatIndex m_node;
+        bool m_single;
+    };
+    const SatNet& m_satNet;
+    SatWorkers& m_workers;
+
+    // the pieces that cover [minID, maxID], in ID order
+    void split(int minID, int maxID, std::vector<Piece>& pieces) const;
+    void splitAt(SatIndex node, int depth, int stopAt, int minID, int maxID, std::vector<Piece>& pieces) const;
+    // calls visit(node) for every node of the piece with ID in [minID, maxID], in order
+    template <class Visit>
+    void walk(const Piece& piece, int minID, int maxID, Visit visit) const;
+};
+#endif
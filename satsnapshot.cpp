@@ -0,0 +1,106 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#include "satsnapshot.h"
+#include <algorithm>
+
+SatSnapshot::SatSnapshot()
+        : m_size(0), m_keys(1, 0), m_attrs(1, 0), m_rank(1, 0), m_prefix(1) {
+}
+
+SatSnapshot::SatSnapshot(const std::vector<Sat>& sorted)
+        : m_size((int)sorted.size()), m_keys(sorted.size() + 1, 0), m_attrs(sorted.size() + 1, 0),
+          m_rank(sorted.size() + 1, 0), m_prefix(sorted.size() + 1) {
+    size_t next = 0;
+    layout(sorted, 1, next);
+    for (size_t i = 0; i < sorted.size(); i++) {
+        m_prefix[i + 1] = m_prefix[i];
+        m_prefix[i + 1].add(sorted[i].getState(), sorted[i].getAlt(), sorted[i].getInclin());
+    }
+}
+
+// LAYOUT
+// an in-order walk of the implicit tree visits positions in ID order
+void SatSnapshot::layout(const std::vector<Sat>& sorted, size_t k, size_t& next) {
+    if (k > sorted.size()) {
+        return;
+    }
+    layout(sorted, 2 * k, next);
+    const Sat& satellite = sorted[next];
+    m_keys[k] = satellite.getID();
+    m_attrs[k] = (uint8_t)(satellite.getAlt() | (satellite.getInclin() << 2) | (satellite.getState() << 4));
+    m_rank[k] = (int32_t)next;
+    next++;
+    layout(sorted, 2 * k + 1, next);
+}
+
+// LOWER BOUND
+// The comparison result picks the child, so there is no branch to mispredict.
+// Positions 16k..16k+15 are the great-great-grandchildren of k and share one
+// cache line, so it is requested four levels before it is needed. The walk
+// ends past a leaf; the trailing 1 bits of k are the right turns taken after
+// the last left turn, and undoing them lands on the answer.
+size_t SatSnapshot::lowerBound(int id) const {
+    const int32_t* keys = m_keys.data();
+    size_t n = (size_t)m_size;
+    size_t k = 1;
+    while (k <= n) {
+        __builtin_prefetch(keys + 16 * k);
+        k = 2 * k + (keys[k] < id);
+    }
+    k >>= __builtin_ffsll(~(long long)k);
+    return k;
+}
+
+int SatSnapshot::rankOf(int id) const {
+    size_t k = lowerBound(id);
+    return (k == 0) ? m_size : m_rank[k];
+}
+
+// QUERIES
+
+bool SatSnapshot::findSatellite(int id) const {
+    size_t k = lowerBound(id);
+    return k != 0 && m_keys[k] == id;
+}
+
+bool SatSnapshot::getState(int id, STATE& state) const {
+    size_t k = lowerBound(id);
+    if (k == 0 || m_keys[k] != id) {
+        return false;
+    }
+    state = (STATE)((m_attrs[k] >> 4) & 3);
+    return true;
+}
+
+int SatSnapshot::countSatellites(INCLIN degree) const{
+    return m_prefix[m_size].m_inclin[degree];
+}
+
+int SatSnapshot::countSatellites(ALT altitude) const{
+    return m_prefix[m_size].m_alt[altitude];
+}
+
+int SatSnapshot::countSatellites(STATE state) const{
+    return m_prefix[m_size].m_state[state];
+}
+
+int SatSnapshot::countSatellites(INCLIN degree, int minID, int maxID) const{
+    return getCounts(minID, maxID).m_inclin[degree];
+}
+
+int SatSnapshot::countSatellites(ALT altitude, int minID, int maxID) const{
+    return getCounts(minID, maxID).m_alt[altitude];
+}
+
+int SatSnapshot::countSatellites(STATE state, int minID, int maxID) const{
+    return getCounts(minID, maxID).m_state[state];
+}
+
+SatCounts SatSnapshot::getCounts(int minID, int maxID) const{
+    if (minID > maxID) {
+        return SatCounts();
+    }
+    // maxID + 1 cannot overflow, IDs are bounded by MAXID
+    SatCounts counts = m_prefix[rankOf(std::min(maxID, MAXID) + 1)];
+    counts.subtract(m_prefix[rankOf(minID)]);
+    return counts;
+}
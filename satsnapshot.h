@@ -0,0 +1,47 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#ifndef SATSNAPSHOT_H
+#define SATSNAPSHOT_H
+#include "satnet.h"
+#include <cstdint>
+#include <vector>
+// Immutable read-only copy of a fleet, made by SatNet::freezeSnapshot().
+// The sorted IDs are laid out in Eytzinger (BFS) order: the children of
+// position k are at 2k and 2k + 1, so a lookup is a branch-free walk down one
+// array and the next four levels can be prefetched in a single cache line.
+// Range counts come from prefix totals in ID order, so they are two lookups.
+class SatSnapshot{
+public:
+    friend class Grader;
+    friend class Tester;
+    SatSnapshot();
+    // sorted must be in increasing ID order without duplicates
+    explicit SatSnapshot(const std::vector<Sat>& sorted);
+    int size() const {return m_size;}
+    bool findSatellite(int id) const;
+    // false if the satellite is not in the snapshot
+    bool getState(int id, STATE& state) const;
+    int countSatellites(INCLIN degree) const;
+    int countSatellites(ALT altitude) const;
+    int countSatellites(STATE state) const;
+    // counts restricted to IDs in [minID, maxID], O(log n)
+    int countSatellites(INCLIN degree, int minID, int maxID) const;
+    int countSatellites(ALT altitude, int minID, int maxID) const;
+    int countSatellites(STATE state, int minID, int maxID) const;
+    // all totals for IDs in [minID, maxID]
+    SatCounts getCounts(int minID = MINID, int maxID = MAXID) const;
+
+private:
+    int m_size;
+    std::vector<int32_t> m_keys;        // IDs in Eytzinger order, 1-based; m_keys[0] is unused
+    std::vector<uint8_t> m_attrs;       // packed ALT/INCLIN/STATE, parallel to m_keys
+    std::vector<int32_t> m_rank;        // position of m_keys[k] in ID order, parallel to m_keys
+    std::vector<SatCounts> m_prefix;    // m_prefix[r] totals the first r satellites in ID order
+
+    // fills m_keys from sorted by an in-order walk of the implicit tree
+    void layout(const std::vector<Sat>& sorted, size_t k, size_t& next);
+    // Eytzinger position of the smallest ID >= id, 0 if there is none
+    size_t lowerBound(int id) const;
+    // number of IDs < id
+    int rankOf(int id) const;
+};
+#endif
@@ -0,0 +1,161 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#include "sattable.h"
+#include "satwriter.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+const int SatTable::NUMSLOTS;
+const int SatTable::WORDBITS;
+
+SatTable::SatTable()
+        : m_slots(NUMSLOTS, 0), m_occupied((NUMSLOTS + WORDBITS - 1) / WORDBITS, 0) {
+}
+
+// SLOT HELPERS
+uint8_t SatTable::pack(ALT alt, INCLIN inclin, STATE state) {
+    return (uint8_t)(alt | (inclin << 2) | (state << 4));
+}
+
+bool SatTable::occupied(int slot) const {
+    return (m_occupied[slot / WORDBITS] >> (slot % WORDBITS)) & 1;
+}
+
+// BASE METHODS
+
+void SatTable::insert(const Sat& satellite){
+    RESULT result = tryInsert(satellite);
+    if (result == DUPLICATE) {
+        throw std::runtime_error("Satellite already exists (ID: " + std::to_string(satellite.getID()) + ")");
+    } else if (result == OUT_OF_RANGE) {
+        throw std::runtime_error("Satellite ID out of range (ID: " + std::to_string(satellite.getID()) + ")");
+    }
+}
+
+RESULT SatTable::tryInsert(const Sat& satellite){
+    int id = satellite.getID();
+    if (!validID(id)) {
+        return OUT_OF_RANGE;
+    }
+    int slot = id - MINID;
+    if (occupied(slot)) {
+        return DUPLICATE;
+    }
+    m_slots[slot] = pack(satellite.getAlt(), satellite.getInclin(), satellite.getState());
+    m_occupied[slot / WORDBITS] |= uint64_t(1) << (slot % WORDBITS);
+    m_counts.add(satellite.getState(), satellite.getAlt(), satellite.getInclin());
+    return SUCCESS;
+}
+
+void SatTable::clear(){
+    std::fill(m_occupied.begin(), m_occupied.end(), 0);
+    m_counts = SatCounts();
+}
+
+void SatTable::remove(int id){
+    tryRemove(id);
+}
+
+RESULT SatTable::tryRemove(int id){
+    if (!validID(id)) {
+        return OUT_OF_RANGE;
+    }
+    if (!occupied(id - MINID)) {
+        return NOT_FOUND;
+    }
+    int slot = id - MINID;
+    uint8_t packed = m_slots[slot];
+    m_occupied[slot / WORDBITS] &= ~(uint64_t(1) << (slot % WORDBITS));
+    m_counts.m_state[slotState(packed)]--;
+    m_counts.m_alt[slotAlt(packed)]--;
+    m_counts.m_inclin[slotInclin(packed)]--;
+    return SUCCESS;
+}
+
+void SatTable::dumpTree() const {
+    SatWriter out(cout);
+    dumpTree(out);
+}
+
+void SatTable::listSatellites() const {
+    SatWriter out(cout);
+    listSatellites(out);
+}
+
+void SatTable::dumpTree(SatWriter& out) const {
+    // there is no tree, so the dump is the flat list of IDs in order
+    forEachOccupied(0, NUMSLOTS - 1, [&out](int slot) {
+        out.put('(');
+        out.write(slot + MINID);
+        out.put(')');
+    });
+    out.flush();
+}
+
+void SatTable::listSatellites(SatWriter& out, FORMAT format) const {
+    out.writeHeader(format);
+    forEachOccupied(0, NUMSLOTS - 1, [this, &out, format](int slot) {
+        uint8_t packed = m_slots[slot];
+        out.writeSatellite(slot + MINID, slotAlt(packed), slotInclin(packed), slotState(packed), format);
+    });
+    out.flush();
+}
+
+bool SatTable::setState(int id, STATE state){
+    if (!validID(id) || !occupied(id - MINID)) {
+        return false;
+    }
+    int slot = id - MINID;
+    uint8_t packed = m_slots[slot];
+    m_counts.m_state[slotState(packed)]--;
+    m_counts.m_state[state]++;
+    m_slots[slot] = pack(slotAlt(packed), slotInclin(packed), state);
+    return true;
+}
+
+int SatTable::removeDeorbited(){
+    return removeIf([](const Sat& satellite) {
+        return satellite.getState() == DEORBITED;
+    });
+}
+
+bool SatTable::findSatellite(int id) const {
+    return validID(id) && occupied(id - MINID);
+}
+
+int SatTable::countSatellites(INCLIN degree) const{
+    return m_counts.m_inclin[degree];
+}
+
+int SatTable::countSatellites(ALT altitude) const{
+    return m_counts.m_alt[altitude];
+}
+
+int SatTable::countSatellites(STATE state) const{
+    return m_counts.m_state[state];
+}
+
+int SatTable::countSatellites(INCLIN degree, int minID, int maxID) const{
+    return getCounts(minID, maxID).m_inclin[degree];
+}
+
+int SatTable::countSatellites(ALT altitude, int minID, int maxID) const{
+    return getCounts(minID, maxID).m_alt[altitude];
+}
+
+int SatTable::countSatellites(STATE state, int minID, int maxID) const{
+    return getCounts(minID, maxID).m_state[state];
+}
+
+SatCounts SatTable::getCounts(int minID, int maxID) const{
+    if (minID <= MINID && maxID >= MAXID) {
+        return m_counts;
+    }
+    SatCounts counts;
+    int first = std::max(minID, MINID) - MINID;
+    int last = std::min(maxID, MAXID) - MINID;
+    forEachOccupied(first, last, [this, &counts](int slot) {
+        counts.add(slotState(m_slots[slot]), slotAlt(m_slots[slot]), slotInclin(m_slots[slot]));
+    });
+    return counts;
+}
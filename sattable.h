@@ -0,0 +1,104 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#ifndef SATTABLE_H
+#define SATTABLE_H
+#include "satnet.h"
+#include <cstdint>
+#include <vector>
+// Direct-indexed storage for a fleet: one slot per possible ID in
+// [MINID, MAXID] plus an occupancy bitmap. It shares SatNet's core API -
+// insert, remove, find, setState, the counts, removeDeorbited/removeIf and
+// the listings - with O(1) insert, remove, find and setState, and lists
+// satellites in ID order by scanning the bitmap. SatNet's bulk loads,
+// batched lookups, iterators, ID sets and snapshots are not part of it. It
+// costs about 100 KB whatever the fleet size, so it suits large fleets;
+// SatNet stays better for small ones.
+class SatTable{
+public:
+    friend class Grader;
+    friend class Tester;
+    SatTable();
+    void insert(const Sat& satellite);
+    RESULT tryInsert(const Sat& satellite);
+    void clear();
+    void remove(int id);
+    RESULT tryRemove(int id);
+    void dumpTree() const;
+    void listSatellites() const;
+    // buffered into out, as for SatNet
+    void dumpTree(SatWriter& out) const;
+    void listSatellites(SatWriter& out, FORMAT format = TEXT) const;
+    bool setState(int id, STATE state);
+    int removeDeorbited();//removes all deorbited satellites from the table, returns how many
+    // removes every satellite the predicate (bool(const Sat&)) holds for, returns how many
+    template <class Predicate>
+    int removeIf(Predicate predicate);
+    bool findSatellite(int id) const; //returns true if the satellite is in the table
+    int countSatellites(INCLIN degree) const;
+    int countSatellites(ALT altitude) const;
+    int countSatellites(STATE state) const;
+    // counts restricted to IDs in [minID, maxID], linear in the range
+    int countSatellites(INCLIN degree, int minID, int maxID) const;
+    int countSatellites(ALT altitude, int minID, int maxID) const;
+    int countSatellites(STATE state, int minID, int maxID) const;
+    // all totals for IDs in [minID, maxID]
+    SatCounts getCounts(int minID = MINID, int maxID = MAXID) const;
+
+private:
+    static const int NUMSLOTS = MAXID - MINID + 1;
+    static const int WORDBITS = 64;
+
+    std::vector<uint8_t> m_slots;       // packed attributes, indexed by id - MINID
+    std::vector<uint64_t> m_occupied;   // bit (id - MINID) is set if the slot is in use
+    SatCounts m_counts;                 // totals over the whole table
+
+    // slot packing: bits 0-1 altitude, bits 2-3 inclination, bits 4-5 state
+    static uint8_t pack(ALT alt, INCLIN inclin, STATE state);
+    static ALT slotAlt(uint8_t slot) {return (ALT)(slot & 3);}
+    static INCLIN slotInclin(uint8_t slot) {return (INCLIN)((slot >> 2) & 3);}
+    static STATE slotState(uint8_t slot) {return (STATE)((slot >> 4) & 3);}
+
+    static bool validID(int id) {return id >= MINID && id <= MAXID;}
+    bool occupied(int slot) const;
+    // calls visit(slot) for every occupied slot in [first, last], in order
+    template <class Visit>
+    void forEachOccupied(int first, int last, Visit visit) const;
+};
+
+// BITMAP SCAN
+// skips empty words 64 slots at a time and jumps between set bits
+template <class Visit>
+void SatTable::forEachOccupied(int first, int last, Visit visit) const {
+    if (first > last) {
+        return;
+    }
+    int lastWord = last / WORDBITS;
+    for (int w = first / WORDBITS; w <= lastWord; w++) {
+        uint64_t bits = m_occupied[w];
+        // mask off the slots outside [first, last] in the edge words
+        if (w == first / WORDBITS) {
+            bits &= ~uint64_t(0) << (first % WORDBITS);
+        }
+        if (w == lastWord && last % WORDBITS != WORDBITS - 1) {
+            bits &= (uint64_t(1) << (last % WORDBITS + 1)) - 1;
+        }
+        while (bits != 0) {
+            visit(w * WORDBITS + __builtin_ctzll(bits));
+            bits &= bits - 1;
+        }
+    }
+}
+
+// removing clears only the bit being visited, so the scan is not disturbed
+template <class Predicate>
+int SatTable::removeIf(Predicate predicate){
+    int removed = 0;
+    forEachOccupied(0, NUMSLOTS - 1, [this, &predicate, &removed](int slot) {
+        uint8_t packed = m_slots[slot];
+        if (predicate(Sat(slot + MINID, slotAlt(packed), slotInclin(packed), slotState(packed)))) {
+            tryRemove(slot + MINID);
+            removed++;
+        }
+    });
+    return removed;
+}
+#endif
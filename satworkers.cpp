@@ -0,0 +1,97 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#include "satworkers.h"
+
+SatWorkers::SatWorkers(int threads)
+        : m_threads(threads < 1 ? 1 : threads), m_task(nullptr), m_count(0), m_next(0), m_done(0),
+          m_active(0), m_generation(0), m_stopping(false) {
+    for (int i = 1; i < m_threads; i++) {
+        m_workers.push_back(std::thread([this]() {
+            workerLoop();
+        }));
+    }
+}
+
+SatWorkers::~SatWorkers(){
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (size_t i = 0; i < m_workers.size(); i++) {
+        m_workers[i].join();
+    }
+}
+
+int SatWorkers::defaultThreads(){
+    unsigned hardware = std::thread::hardware_concurrency();
+    return hardware == 0 ? 1 : (int)hardware;
+}
+
+int SatWorkers::drain(const std::function<void(int)>& task, int count){
+    int ran = 0;
+    for (int i = m_next.fetch_add(1); i < count; i = m_next.fetch_add(1)) {
+        task(i);
+        ran++;
+    }
+    return ran;
+}
+
+// A job is over once every task has finished and every worker that joined it
+// has left, so a slow worker can never pick up task numbers of the next job.
+void SatWorkers::run(int count, const std::function<void(int)>& task){
+    if (count <= 0) {
+        return;
+    }
+    if (m_threads == 1 || count == 1) {
+        for (int i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> job(m_jobMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_count = count;
+        m_next = 0;
+        m_done = 0;
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    int ran = drain(task, count);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done += ran;
+    m_finished.wait(lock, [this]() {
+        return m_done == m_count && m_active == 0;
+    });
+    m_task = nullptr;
+}
+
+void SatWorkers::workerLoop(){
+    unsigned seen = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this, &seen]() {
+            return m_stopping || (m_task != nullptr && m_generation != seen);
+        });
+        if (m_stopping) {
+            return;
+        }
+        seen = m_generation;
+        const std::function<void(int)>& task = *m_task;
+        int count = m_count;
+        m_active++;
+        lock.unlock();
+
+        int ran = drain(task, count);
+
+        lock.lock();
+        m_done += ran;
+        m_active--;
+        if (m_done == m_count && m_active == 0) {
+            m_finished.notify_all();
+        }
+    }
+}
@@ -0,0 +1,48 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#ifndef SATWORKERS_H
+#define SATWORKERS_H
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+// A fixed set of worker threads for splitting fleet-wide work (bulk builds,
+// copies, aggregate queries) into tasks. run() hands out task numbers from a
+// shared counter, so a thread that finishes early simply takes the next one
+// and uneven tasks even out; the calling thread takes tasks too. Jobs from
+// different callers run one after the other, and a task must not throw.
+class SatWorkers{
+public:
+    // threads counts the calling thread, so SatWorkers(1) starts no thread
+    explicit SatWorkers(int threads = defaultThreads());
+    SatWorkers(const SatWorkers& rhs) = delete;
+    SatWorkers& operator=(const SatWorkers& rhs) = delete;
+    ~SatWorkers();
+    int threads() const {return m_threads;}
+    // calls task(i) for every i in [0, count) and returns once all are done
+    void run(int count, const std::function<void(int)>& task);
+    // one per hardware thread, at least 1
+    static int defaultThreads();
+
+private:
+    int m_threads;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_jobMutex;              // held by run() for the length of a job
+    std::mutex m_mutex;                 // guards the job state below
+    std::condition_variable m_wake;     // a job was posted or the pool is stopping
+    std::condition_variable m_finished; // the last task finished or the last worker left
+    const std::function<void(int)>* m_task;
+    int m_count;
+    std::atomic<int> m_next;            // next task number to hand out
+    int m_done;                         // tasks finished
+    int m_active;                       // workers inside the current job
+    unsigned m_generation;              // bumped for every job
+    bool m_stopping;
+
+    void workerLoop();
+    // runs tasks until none are left, returns how many it ran
+    int drain(const std::function<void(int)>& task, int count);
+};
+#endif
@@ -0,0 +1,152 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#include "satwriter.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+const size_t SatWriter::BUFFERSIZE;
+
+// STRING TABLES
+// the texts of Sat::getStateStr, getInclinStr and getAltStr, and the bare
+// numbers the CSV and JSON lines use, indexed by enum value
+namespace {
+struct Text{
+    const char* m_text;
+    size_t m_size;
+};
+#define SATTEXT(s) {s, sizeof(s) - 1}
+const Text STATENAMES[NUMSTATES] = {SATTEXT("Active"), SATTEXT("Deorbited"), SATTEXT("Decaying")};
+const Text INCLINNAMES[NUMINCLINS] = {SATTEXT("48 degrees"), SATTEXT("53 degrees"), SATTEXT("70 degrees"),
+                                      SATTEXT("97 degrees")};
+const Text ALTNAMES[NUMALTS] = {SATTEXT("208 miles"), SATTEXT("215 miles"), SATTEXT("340 miles"),
+                                SATTEXT("350 miles")};
+const Text INCLINNUMBERS[NUMINCLINS] = {SATTEXT("48"), SATTEXT("53"), SATTEXT("70"), SATTEXT("97")};
+const Text ALTNUMBERS[NUMALTS] = {SATTEXT("208"), SATTEXT("215"), SATTEXT("340"), SATTEXT("350")};
+#undef SATTEXT
+}
+
+SatWriter::SatWriter(std::ostream& out) : m_stream(&out), m_buffer(BUFFERSIZE), m_used(0) {
+    m_sink = [&out](const char* data, size_t size) {
+        out.write(data, size);
+        if (!out) {
+            throw std::runtime_error("Writing the listing to the stream failed");
+        }
+    };
+}
+
+SatWriter::SatWriter(int fd) : m_stream(nullptr), m_buffer(BUFFERSIZE), m_used(0) {
+    m_sink = [fd](const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("Writing the listing failed: " + std::string(std::strerror(errno)));
+            }
+            data += written;
+            size -= written;
+        }
+    };
+}
+
+SatWriter::SatWriter(Sink sink) : m_sink(std::move(sink)), m_stream(nullptr), m_buffer(BUFFERSIZE), m_used(0) {
+}
+
+SatWriter::~SatWriter(){
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // a destructor must not throw; call flush() first to see the error
+    }
+}
+
+void SatWriter::drain(){
+    if (m_used > 0) {
+        // emptied first, so a sink that throws does not get the same bytes again
+        size_t used = m_used;
+        m_used = 0;
+        m_sink(m_buffer.data(), used);
+    }
+}
+
+void SatWriter::flush(){
+    drain();
+    if (m_stream != nullptr) {
+        m_stream->flush();
+    }
+}
+
+// text longer than the whole buffer goes to the sink directly
+void SatWriter::writeLong(const char* text, size_t size){
+    drain();
+    if (size > BUFFERSIZE) {
+        m_sink(text, size);
+        return;
+    }
+    std::memcpy(m_buffer.data(), text, size);
+    m_used = size;
+}
+
+void SatWriter::write(const char* text){
+    write(text, std::strlen(text));
+}
+
+// digits are produced backwards into a small array, without a stream or a string
+void SatWriter::write(int value){
+    char digits[12];
+    int at = sizeof(digits);
+    unsigned magnitude = (value < 0) ? 0u - (unsigned)value : (unsigned)value;
+    do {
+        digits[--at] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) {
+        digits[--at] = '-';
+    }
+    write(digits + at, sizeof(digits) - at);
+}
+
+void SatWriter::writeHeader(FORMAT format){
+    if (format == CSV) {
+        write("id,state,inclination,altitude\n");
+    }
+}
+
+void SatWriter::writeSatellite(int id, ALT alt, INCLIN inclin, STATE state, FORMAT format){
+    switch (format) {
+        case CSV:
+            write(id);
+            put(',');
+            write(STATENAMES[state].m_text, STATENAMES[state].m_size);
+            put(',');
+            write(INCLINNUMBERS[inclin].m_text, INCLINNUMBERS[inclin].m_size);
+            put(',');
+            write(ALTNUMBERS[alt].m_text, ALTNUMBERS[alt].m_size);
+            break;
+        case JSONL:
+            write("{\"id\":", 6);
+            write(id);
+            write(",\"state\":\"", 10);
+            write(STATENAMES[state].m_text, STATENAMES[state].m_size);
+            write("\",\"inclination\":", 16);
+            write(INCLINNUMBERS[inclin].m_text, INCLINNUMBERS[inclin].m_size);
+            write(",\"altitude\":", 12);
+            write(ALTNUMBERS[alt].m_text, ALTNUMBERS[alt].m_size);
+            put('}');
+            break;
+        default:
+            // the format listSatellites() has always printed
+            write(id);
+            write(": ", 2);
+            write(STATENAMES[state].m_text, STATENAMES[state].m_size);
+            write(": ", 2);
+            write(INCLINNAMES[inclin].m_text, INCLINNAMES[inclin].m_size);
+            write(": ", 2);
+            write(ALTNAMES[alt].m_text, ALTNAMES[alt].m_size);
+            break;
+    }
+    put('\n');
+}
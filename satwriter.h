@@ -0,0 +1,57 @@
+// UMBC - CMSC 341 - Fall 2023 - Proj2
+#ifndef SATWRITER_H
+#define SATWRITER_H
+#include "satnet.h"
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <vector>
+// Buffered output for listings and dumps. Text collects in a 64 KB buffer
+// and goes to the sink only when the buffer fills or on flush(), so a full
+// fleet listing is a few dozen writes instead of one flush per line. The sink
+// is a std::ostream, a file descriptor or a callback taking each chunk.
+// Numbers and attribute names are copied in from static tables; nothing is
+// allocated per line. A sink that fails throws std::runtime_error from the
+// call that flushed; the destructor flushes what is left and drops errors.
+class SatWriter{
+public:
+    typedef std::function<void(const char* data, size_t size)> Sink;
+    explicit SatWriter(std::ostream& out);
+    // writes to fd with write(2), retrying short writes; fd stays open
+    explicit SatWriter(int fd);
+    explicit SatWriter(Sink sink);
+    SatWriter(const SatWriter& rhs) = delete;
+    SatWriter& operator=(const SatWriter& rhs) = delete;
+    ~SatWriter();
+    void put(char c) {if (m_used == BUFFERSIZE) drain(); m_buffer[m_used++] = c;}
+    void write(const char* text, size_t size) {
+        if (size <= BUFFERSIZE - m_used) {
+            std::memcpy(m_buffer.data() + m_used, text, size);
+            m_used += size;
+        } else {
+            writeLong(text, size);
+        }
+    }
+    void write(const char* text);
+    void write(int value);
+    // one line of a listing in the given format
+    void writeSatellite(int id, ALT alt, INCLIN inclin, STATE state, FORMAT format);
+    // the line a CSV listing starts with, nothing for the other formats
+    void writeHeader(FORMAT format);
+    // passes everything buffered to the sink, and flushes a stream sink
+    void flush();
+
+private:
+    static const size_t BUFFERSIZE = 1 << 16;
+    Sink m_sink;
+    std::ostream* m_stream;     // the stream sink, flushed by flush(); null for the others
+    std::vector<char> m_buffer;
+    size_t m_used;              // bytes of m_buffer waiting for the sink
+
+    // passes the buffer to the sink and empties it
+    void drain();
+    // write() for text that does not fit in what is left of the buffer
+    void writeLong(const char* text, size_t size);
+};
+#endif